@@ -1,258 +1,482 @@
-// PreyPredator.cpp : main project file.
-// Defines the entry point for the console application.
-
-#include "stdafx.h"
-#include <stdio.h>
-#include <stdlib.h>
-#include <math.h> 
-#include <iostream>
-//#include <omp.h>
-#include <time.h> 
-#include <array>
-using namespace std;
-
-//speed selected will display every nth generation (1,10 or 100)
-#define FAST 100
-#define MEDIUM 10
-#define SLOW 1
-
-//array dimensions
-#define HEIGHT 1024
-#define WIDTH 2048
-
-//total number of steps to be done
-#define NUMBER_OF_STEPS 500
-
-//global map with 2 extra rows and 2 extra columns to deal with boundaries
-int oldMap[HEIGHT + 2][WIDTH + 2] = { 0 };
-
-int newMap[HEIGHT + 2][WIDTH + 2];
-
-int numOfThreads;
-
-//ages all the fish and sharks, kills the ones that should die, and spawns the ones that live
-//all changes are stored in newMap and then copied into oldMap
-//void update();
-
-//displays the whole grid to the console
-void print();
-//returns the number of fish and sharks as a pair (fish, shark) in the whole ocean
-pair<int, int> analyze();
-//returns the number of neighboring fish and sharks and specifies how many are adults  of a given cell
-//where i and j specify the location of that cell
-//the returned format will be in an array of four numbers:
-//number of all neighboring fish, number of adult neighboring fish, number of all neighboring sharks, number of adult neighboring sharks)
-//array<int, 4>  neighborCount(int i, int j);
-//void evaluate(int value, int &fish, int &adultFish, int &sharks, int &adultSharks);
-
-int main()
-{
-	clock_t t1, t2;
-	t1 = clock();
-
-	//setting the speed
-	int speed = FAST;
-
-	int i, j = 0;
-	float randFloat;
-	//initializing the array with 50% fish, 25% sharks, and 25% empty cells
-	//note that the borders (2 rows and 2 columns) are left empty as they will be overwritten next
-
-	for (i = 1; i <= HEIGHT; i++) {
-		for (j = 1; j <= WIDTH; j++) {
-			randFloat = rand() / ((float)RAND_MAX + 1);
-			if (randFloat<0.25) {
-				//25% are empty
-				oldMap[i][j] = 0;
-			}
-			else if (randFloat >= 0.25 && randFloat<0.5) {
-				//25% are sharks
-				oldMap[i][j] = -1;
-			}
-			else {
-				//50% are fish
-				oldMap[i][j] = 1;
-			}
-		}
-	}
-
-	//to repeat the simulation NUMBER_OF_STEPS of times
-	for (int n = 0; n <= NUMBER_OF_STEPS; n++) { //TODO instead of 1 iteration, number of steps
-												 //now we need to copy the edges to simulate an infinite ocean
-												 //starting with the corners (to not go over them twice if we loop vertically and horizontally)
-		oldMap[0][0] = oldMap[HEIGHT][WIDTH];
-		oldMap[0][WIDTH + 1] = oldMap[HEIGHT][1];
-		oldMap[HEIGHT + 1][WIDTH + 1] = oldMap[1][1];
-		oldMap[HEIGHT + 1][0] = oldMap[1][WIDTH];
-		/* left-right boundary conditions */
-		for (i = 1; i <= HEIGHT; i++) {
-			oldMap[i][0] = oldMap[i][WIDTH];
-			oldMap[i][WIDTH + 1] = oldMap[i][1];
-		}
-		/* top-bottom boundary conditions */
-		for (j = 1; j <= WIDTH; j++) {
-			oldMap[0][j] = oldMap[HEIGHT][j];
-			oldMap[HEIGHT + 1][j] = oldMap[1][j];
-		}
-
-		//print();
-		//going through the entire 2D array
-		//update();
-		//replacing update with its code content:
-		//i and j will be used in the for loops
-		
-		//int i, j = 0;
-		//specifies the number of threads that will run in parallel
-		numOfThreads = 8;
-#pragma omp parallel num_threads(numOfThreads)
-		{
-//#pragma omp for schedule(guided,1)
-#pragma omp for schedule(dynamic)
-			for (int i = 1; i <= HEIGHT; i++) {
-				for (int j = 1; j <= WIDTH; j++) {
-					//for each cell we count how many neighbors it has
-					//replacing neighborCount function:
-					//nFish is the number of neighboring fish, nAdultFish is the number of neighboring adult fish
-					//nSharks is the number of neighboring sharks, nAdultSharks is the number of neighboring adult sharks
-					int nFish = 0;
-					int nAdultFish = 0;
-					int nSharks = 0;
-					int nAdultSharks = 0;
-
-					//to ensure that the function is not given a boundary cell
-					if (i <= 0 || j <= 0 || (i >= HEIGHT + 1) || (j >= WIDTH + 1)) {
-						cout << "passed an invalid cell to neighborCount" << endl;
-						//return NULL;
-					}
-					int iMinus, iPlus, jMinus, jPlus;
-					iMinus = i - 1;
-					iPlus = i + 1;
-					jMinus = j - 1;
-					jPlus = j + 1;
-
-					//1  2  3
-					//4  X  5
-					//6  7  8
-					array<int, 8> cellNeighbors = { oldMap[iMinus][jMinus], oldMap[i][jMinus], oldMap[iPlus][jMinus] //neighbors 1,2,3
-					, oldMap[iMinus][j] , oldMap[iPlus][j]   // neighbors 4 and 5
-					, oldMap[iMinus][jPlus], oldMap[i][jPlus] , oldMap[iPlus][jPlus] }; // neighbors 6,7,8
-				
-					for (int neighborsCounter = 0; neighborsCounter < 8; neighborsCounter++) {
-						//replacing the evaluate function:
-						if (cellNeighbors[neighborsCounter] == 0) { //empty cell
-							continue;
-						} else 
-						if (cellNeighbors[neighborsCounter] > 0) { // fish
-							nFish++;
-							if (cellNeighbors[neighborsCounter] >= 2) { // adult fish
-								nAdultFish++;
-							}
-						} else 
-						if (cellNeighbors[neighborsCounter] < 0) { //shark
-							nSharks++;
-							if (cellNeighbors[neighborsCounter] <= -3) { //adult shark
-								nAdultSharks++;
-							}
-						}
-					}
-
-					if (oldMap[i][j] > 0) { //fish
-											//implementing all the fish rules
-											//a fish can die by being eaten, overpopulation, or old age
-						if (nSharks >= 5 || nFish == 8 || oldMap[i][j] == 10) {
-							newMap[i][j] = 0; //fish dies 
-						}
-						else {
-							//the fish survived, we increment its age
-							newMap[i][j] = oldMap[i][j] + 1;
-						}
-					}
-					else if (oldMap[i][j] < 0) { //shark
-												 //implementing all the shark rules
-						float sharkHeartAttack;
-						sharkHeartAttack = rand() / ((float)RAND_MAX + 1);
-						//a shark can die by either starvation or randomly or because of old age
-						if ((nSharks >= 6 && nFish == 0) || (sharkHeartAttack <= 0.031) || (oldMap[i][j] <= -20)) {
-							newMap[i][j] = 0; //shark dies
-						}
-						else {
-							//shark survives, increment age by making the cell's value more negative
-							newMap[i][j] = oldMap[i][j] - 1;
-						}
-					}
-					else { //empty
-						   //breeding rules
-						if (nFish >= 4 && nAdultFish >= 3 && nSharks < 4) {
-							newMap[i][j] = 1; //a fish is born
-						}
-						else if (nSharks >= 4 && nAdultSharks >= 3 && nFish < 4) {
-							newMap[i][j] = -1; //a shark is born
-						}
-						else {
-							//nothing is born
-							newMap[i][j] = oldMap[i][j]; //or set it to 0 (since this cell was empty and will remain empty)
-						}
-					}
-				}
-			}
-		}
-		//now we copy the new map into the old map
-		for (i = 1; i <= HEIGHT; i++) {
-			for (j = 1; j <= WIDTH; j++) {
-				oldMap[i][j] = newMap[i][j];
-			}
-		}
-
-		if (n%speed == 0) {
-			cout << "Generation " << n << endl;
-			cout << "there are: " << analyze().first << " fish and " << analyze().second << " sharks" << endl;
-		}
-	}
-	//when all the time steps are complete
-	t2 = clock();
-	//displaying the ascii visualization is only viable when width and height are small enough
-	//print();
-
-	float diff((float)t2 - (float)t1);
-	cout << "Parallel processing using OpenMP of a " << WIDTH << "x" << HEIGHT << " grid. Performing " << NUMBER_OF_STEPS << " iterations." << endl;
-	printf("Processing time %f seconds \n", (diff / 1000));
-	printf("using %d threads\n", numOfThreads);
-	system("pause");
-	return 0;
-}
-
-void print() {
-	for (int i = 1; i < HEIGHT + 1; i++) {
-		for (int j = 1; j < WIDTH + 1; j++) {
-			//cout << " ";
-			if (oldMap[i][j] > 0) {
-				cout << "f";// << oldMap[i][j];
-			}
-			else if (oldMap[i][j] < 0) {
-				cout << "s";
-			}
-			else {
-				cout << "-";
-			}
-			//cout << " ";
-		}
-		cout << endl;
-	}
-	cout << endl;
-}
-
-pair<int, int> analyze() {
-	int numOfFish = 0;
-	int numOfSharks = 0;
-	for (int i = 1; i <= HEIGHT; i++) {
-		for (int j = 1; j <= WIDTH; j++) {
-			if (oldMap[i][j] < 0) {
-				numOfSharks++;
-			}
-			if (oldMap[i][j] > 0) {
-				numOfFish++;
-			}
-		}
-	}
-	return pair<int, int>(numOfFish, numOfSharks);
-}
+// PreyPredator.cpp : main project file.
+// Defines the entry point for the console application.
+
+#include "stdafx.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h> 
+#include <iostream>
+#include <omp.h>
+#include <time.h> 
+#include <array>
+#include <algorithm>
+#include <vector>
+#include "../../common/Ocean.h"
+#include "../../common/Options.h"
+#include "../../common/Kernel.h"
+#include "../../common/Random.h"
+#include "../../common/Stats.h"
+#include "../../common/Series.h"
+#include "../../common/Snapshot.h"
+#include "../../common/GenerationLog.h"
+#include "../../common/DensityPyramid.h"
+#include "../../common/FrameChannel.h"
+using namespace std;
+
+//speed selected will display every nth generation (1,10 or 100)
+#define FAST 100
+#define MEDIUM 10
+#define SLOW 1
+
+//default array dimensions, can be changed at runtime with --height= and --width=
+#define HEIGHT 1024
+#define WIDTH 2048
+
+//default total number of steps to be done, can be changed at runtime with --steps=
+#define NUMBER_OF_STEPS 500
+
+//default seed of the random numbers, can be changed at runtime with --seed=
+//the same seed gives the same ocean whatever the number of threads or processes
+#define SEED 1
+
+//default number of generations a thread advances a band of rows before writing it back, can be changed at runtime with --tile=
+//1 computes one generation at a time over the whole ocean, more keeps a band in the cache for several generations
+#define TILE 1
+//default number of rows in a band, can be changed at runtime with --band=
+#define BAND 64
+
+//default number of generations between two snapshots with --snapshot=, can be changed at runtime with --snapshots=
+#define SNAPSHOT_INTERVAL 100
+
+//default number of generations between two keyframes of a log with --record=, can be changed at runtime with --keyframes=
+#define KEYFRAME_INTERVAL 100
+
+int numOfThreads;
+
+//ages all the fish and sharks, kills the ones that should die, and spawns the ones that live
+//all changes are stored in newMap, which then becomes the current map by swapping the two buffers
+//void update();
+
+//displays the whole grid to the console
+void print(Ocean<cell_t> &ocean);
+//returns the number of fish and sharks as a pair (fish, shark) in the whole ocean
+//no longer needed every displayed generation since the kernels count them, kept to check their counts
+pair<int, int> analyze(Ocean<cell_t> &ocean);
+//returns the number of neighboring fish and sharks and specifies how many are adults  of a given cell
+//where i and j specify the location of that cell
+//the returned format will be in an array of four numbers:
+//number of all neighboring fish, number of adult neighboring fish, number of all neighboring sharks, number of adult neighboring sharks)
+//array<int, 4>  neighborCount(int i, int j);
+//void evaluate(int value, int &fish, int &adultFish, int &sharks, int &adultSharks);
+
+//advances the rows first..last of the ocean by steps generations, starting at generation, and writes them into its newMap
+//the band is copied into scratch with steps extra rows above and below it, each generation is then computed on one row less
+//at each end, so the rows of the band are right after the last one without reading anything the other threads write
+//generation + s of the band rows is added to stats[s], the extra rows belong to other bands and are not counted
+//when ages is true the age histograms are added too, each row is counted right after it is computed,
+//and when density is not NULL the fish and sharks of the rows of the last generation are counted into its tiles (see DensityPyramid.h)
+void updateBand(Ocean<cell_t> &ocean, Ocean<cell_t> &scratch, int first, int last, int steps,
+	RowKernel<cell_t>::Function kernel, uint32_t seed, int generation, OceanStats *stats, bool ages, DensityPyramid *density);
+//row i of an infinite ocean, brought back between 1 and height
+inline int wrapRow(int i, int height) {
+	return ((i - 1) % height + height) % height + 1;
+}
+
+int main(int argc, char *argv[])
+{
+	clock_t t1, t2;
+	t1 = clock();
+
+	//setting the speed, --speed=1 displays the statistics of every generation
+	int speed = intOption(argc, argv, "speed", FAST);
+	if (speed < 1) {
+		printf("--speed has to be at least 1\n");
+		return 1;
+	}
+
+	int height = intOption(argc, argv, "height", HEIGHT);
+	int width = intOption(argc, argv, "width", WIDTH);
+	int numberOfSteps = intOption(argc, argv, "steps", NUMBER_OF_STEPS);
+	uint32_t seed = (uint32_t)intOption(argc, argv, "seed", SEED);
+	if (height < 1 || width < 1 || numberOfSteps < 1) {
+		printf("--height, --width and --steps have to be at least 1\n");
+		return 1;
+	}
+	//the first generation to compute, a restarted run goes on from the generation of its snapshot
+	int first = 0;
+
+	//--restart=file goes on from a snapshot written by --snapshot= (see Snapshot.h)
+	//the size of the ocean, the seed and the generation are the ones of the snapshot
+	SnapshotReader restart;
+	const char *restartPath = optionValue(argc, argv, "restart");
+	if (restartPath != NULL) {
+		if (!restart.open(restartPath) || restart.header().generation > INT_MAX) {
+			printf("%s is not a snapshot\n", restartPath);
+			return 1;
+		}
+		height = (int)restart.header().height;
+		width = (int)restart.header().width;
+		seed = (uint32_t)restart.header().seed;
+		first = (int)restart.header().generation;
+	}
+	//--replay=file goes on from a state of a log written by --record= (see GenerationLog.h), the state given by --generation=
+	//or the first one of the log, it is rebuilt from the keyframe before it and the deltas in between
+	GenerationLog replay;
+	const char *replayPath = optionValue(argc, argv, "replay");
+	if (replayPath != NULL) {
+		if (restartPath != NULL) {
+			printf("--restart and --replay cannot be used together\n");
+			return 1;
+		}
+		if (!replay.open(replayPath)) {
+			printf("%s is not a log of generations\n", replayPath);
+			return 1;
+		}
+		int generation = intOption(argc, argv, "generation", (int)replay.firstState());
+		if (!replay.rebuild(generation)) {
+			printf("%s does not hold generation %d\n", replayPath, generation);
+			return 1;
+		}
+		height = replay.height();
+		width = replay.width();
+		seed = replay.seed();
+		first = generation;
+	}
+
+	//map with 2 extra rows and 2 extra columns to deal with boundaries
+	Ocean<cell_t> ocean(height, width);
+
+	//the AVX2 kernel is used when the processor supports it, unless --kernel=scalar is given
+	//--rules= picks one of the rule sets compiled into the program (see Rules.h)
+	const char *rules = optionValue(argc, argv, "rules");
+	if (rules == NULL) {
+		rules = DEFAULT_RULES;
+	}
+	RowKernel<cell_t>::Function kernel = selectRowKernel<cell_t>(optionIs(argc, argv, "kernel", "scalar"), rules);
+	if (kernel == NULL) {
+		printf("unknown rules %s, the rules are:", rules);
+		printRuleNames();
+		return 1;
+	}
+
+	int tile = intOption(argc, argv, "tile", TILE);
+	int band = intOption(argc, argv, "band", BAND);
+	if (tile < 1 || band < 1) {
+		printf("--tile and --band have to be at least 1\n");
+		return 1;
+	}
+
+	//--series=file writes the statistics and age histograms of every generation to file, as CSV or binary when it ends in .bin
+	SeriesWriter series;
+	const char *seriesPath = optionValue(argc, argv, "series");
+	if (seriesPath != NULL && !series.open(seriesPath)) {
+		printf("cannot create %s\n", seriesPath);
+		return 1;
+	}
+	bool ages = series.isOpen();
+	//--snapshot=file saves the ocean to file every --snapshots= generations and after the last one, for --restart=
+	//the cells are copied after the swap and a background thread writes them through a mapped file
+	//--compress=k has k threads compress the cells of every snapshot before they are written (see BandCodec.h)
+	SnapshotWriter snapshots;
+	const char *snapshotPath = optionValue(argc, argv, "snapshot");
+	int snapshotInterval = intOption(argc, argv, "snapshots", SNAPSHOT_INTERVAL);
+	int compressThreads = intOption(argc, argv, "compress", 0);
+	if (snapshotPath != NULL) {
+		snapshots.start(snapshotPath, compressThreads);
+	}
+	//--record=file records every generation to file, a keyframe every --keyframes= generations and only the cells
+	//that changed occupant in between, with an index of the keyframes in file.idx so --replay= can rebuild any of them
+	GenerationRecorder recorder;
+	const char *recordPath = optionValue(argc, argv, "record");
+	if (recordPath != NULL && !recorder.open(recordPath, height, width, seed, intOption(argc, argv, "keyframes", KEYFRAME_INTERVAL))) {
+		printf("cannot create %s\n", recordPath);
+		return 1;
+	}
+	//--view=columns displays a map of the ocean at most columns characters wide with the statistics,
+	//from the tiles of a density pyramid counted by the threads while the displayed generations are computed
+	int viewColumns = intOption(argc, argv, "view", 0);
+	DensityPyramid *density = viewColumns > 0 ? new DensityPyramid(height, width) : NULL;
+	int viewLevel = density != NULL ? density->levelFor(viewColumns) : 0;
+	//--publish=name hands every displayed generation to a viewer through the shared memory called name (see FrameChannel.h),
+	//the tiles of the map with --view= and otherwise all the cells, the simulation never waits for the viewer
+	FramePublisher publisher;
+	const char *publishName = optionValue(argc, argv, "publish");
+	if (publishName != NULL) {
+		size_t capacity = density != NULL ? sizeof(DensityTile) * density->tileRows(viewLevel) * density->tileColumns(viewLevel) : (size_t)height * width;
+		if (!publisher.open(publishName, capacity)) {
+			printf("cannot create the shared memory %s\n", publishName);
+			return 1;
+		}
+	}
+
+	//specifies the number of threads that will run in parallel
+	numOfThreads = 8;
+	if (restartPath != NULL) {
+		if (!restart.load(ocean)) {
+			printf("%s holds a value that is not a cell\n", restartPath);
+			return 1;
+		}
+		restart.close();
+	}
+	else if (replayPath != NULL) {
+		if (!replay.load(ocean)) {
+			printf("%s holds a value that is not a cell\n", replayPath);
+			return 1;
+		}
+		replay.close();
+	}
+	else {
+		//initializing the array with 50% fish, 25% sharks, and 25% empty cells
+		//note that the borders (2 rows and 2 columns) are left empty as they will be overwritten next
+		//every cell has its own random number, so the threads can fill the rows in any order
+#pragma omp parallel for num_threads(numOfThreads)
+		for (int i = 1; i <= height; i++) {
+			cell_t *row = ocean.oldRow(i);
+			for (int j = 1; j <= width; j++) {
+				row[j] = initialCell<cell_t>(seed, i, j);
+			}
+		}
+	}
+
+	//the starting state is the first one of the log
+	if (recorder.isOpen()) {
+		recorder.record(ocean, first);
+	}
+	//every thread has its own scratch ocean, big enough for a band and the extra rows of tile generations
+	//allocated once by the thread that uses it, and reused by all the generations done at once
+	vector<Ocean<cell_t> *> scratches(numOfThreads, NULL);
+	if (tile > 1) {
+#pragma omp parallel num_threads(numOfThreads)
+		scratches[omp_get_thread_num()] = new Ocean<cell_t>(band + 2 * tile, width);
+	}
+	//number of generations done at once
+	int steps;
+	//to repeat the simulation numberOfSteps of times
+	for (int n = first; n <= numberOfSteps; n += steps) {
+		//up to tile generations at once, stopping at the last one and at the ones that are displayed or saved
+		int nextDisplay = (n + speed - 1) / speed * speed;
+		steps = min(tile, min(numberOfSteps, nextDisplay) - n + 1);
+		if (snapshots.isOpen() && snapshotInterval > 0) {
+			//the next generation after which a snapshot is taken
+			int nextSnapshot = (n + snapshotInterval) / snapshotInterval * snapshotInterval - 1;
+			steps = min(steps, nextSnapshot - n + 1);
+		}
+		//every generation is recorded, so the bands cannot skip any
+		if (recorder.isOpen()) {
+			steps = 1;
+		}
+		//now we need to copy the edges to simulate an infinite ocean
+		ocean.wrapBoundaries();
+		//what each of these generations did, counted by the kernels while they compute it
+		vector<OceanStats> stats(steps);
+		for (int s = 0; s < steps; s++) {
+			stats[s].clear();
+		}
+		//the rows are only counted for the map when the last of these generations is displayed
+		DensityPyramid *counted = (n + steps - 1) % speed == 0 ? density : NULL;
+
+		if (steps > 1) {
+#pragma omp parallel num_threads(numOfThreads)
+			{
+				Ocean<cell_t> &scratch = *scratches[omp_get_thread_num()];
+				vector<OceanStats> threadStats(steps);
+				for (int s = 0; s < steps; s++) {
+					threadStats[s].clear();
+				}
+#pragma omp for schedule(dynamic)
+				for (int first = 1; first <= height; first += band) {
+					updateBand(ocean, scratch, first, min(first + band - 1, height), steps, kernel, seed, n, &threadStats[0], ages, counted);
+				}
+#pragma omp critical
+				for (int s = 0; s < steps; s++) {
+					stats[s].add(threadStats[s]);
+				}
+			}
+			ocean.swap();
+		}
+		else {
+			//print();
+			//going through the entire 2D array
+			//update();
+			//replacing update with its code content:
+			//i and j will be used in the for loops
+		
+			//int i, j = 0;
+#pragma omp parallel num_threads(numOfThreads)
+			{
+				//every thread counts its own rows, the counts are added together once at the end
+				OceanStats threadStats;
+				threadStats.clear();
+//#pragma omp for schedule(guided,1)
+#pragma omp for schedule(dynamic)
+				for (int i = 1; i <= height; i++) {
+					const cell_t *above = ocean.oldRow(i - 1);
+					const cell_t *here = ocean.oldRow(i);
+					const cell_t *below = ocean.oldRow(i + 1);
+					cell_t *newRow = ocean.newRow(i);
+					//the rules are applied to the whole row at once (see Kernel.h)
+					kernel(above, here, below, newRow, 1, width, rowRandom(seed, n, i, 0), threadStats);
+					//the ages are counted while the new row is still in the cache
+					if (ages) {
+						countAges(newRow, 1, width, threadStats);
+					}
+					if (counted != NULL) {
+						counted->countCells(i, newRow, 1, width);
+					}
+				}
+#pragma omp critical
+				stats[0].add(threadStats);
+			}
+			//the new map becomes the current one, no copying needed
+			ocean.swap();
+		}
+
+		//the writer thread writes them to the file while the next generations are computed
+		for (int s = 0; s < steps && series.isOpen(); s++) {
+			series.write(n + s, stats[s]);
+		}
+		int last = n + steps - 1;
+		//the next generation to compute is last + 1
+		if (snapshots.isOpen() && ((snapshotInterval > 0 && (last + 1) % snapshotInterval == 0) || last == numberOfSteps)) {
+			snapshots.capture(ocean, last + 1, seed);
+		}
+		if (recorder.isOpen()) {
+			recorder.record(ocean, last + 1);
+		}
+		if (last%speed == 0) {
+			//pair<int, int> members = analyze(ocean);
+			cout << "Generation " << last << endl;
+			cout << "there are: " << stats[steps - 1].fish << " fish and " << stats[steps - 1].sharks << " sharks" << endl;
+			printStats(stats[steps - 1]);
+			if (density != NULL) {
+				density->build();
+				printDensity(*density, viewLevel);
+			}
+			if (publisher.isOpen()) {
+				if (density != NULL) {
+					publisher.publishDensity(*density, viewLevel, last);
+				}
+				else {
+					publisher.publishCells(ocean, last);
+				}
+			}
+		}
+	}
+	//when all the time steps are complete
+	t2 = clock();
+	//the records still queued are written after the clock is stopped
+	series.close();
+	snapshots.close();
+	if (snapshots.droppedSnapshots() > 0 || snapshots.failedSnapshots() > 0) {
+		printf("%d snapshots were replaced by newer ones before they were written, %d could not be written\n",
+			snapshots.droppedSnapshots(), snapshots.failedSnapshots());
+	}
+	if (compressThreads > 0 && snapshots.rawCellBytes() > 0) {
+		printf("the snapshots took %.1f%% of the size of their cells\n", 100.0 * snapshots.storedCellBytes() / snapshots.rawCellBytes());
+	}
+	if (publisher.isOpen()) {
+		publisher.close();
+		printf("%llu frames were replaced by newer ones before the viewer took them\n", (unsigned long long)publisher.droppedFrames());
+	}
+	if (recorder.isOpen()) {
+		if (!recorder.close()) {
+			printf("cannot write %s\n", recordPath);
+		}
+		printf("recorded %d keyframes and %d deltas, %lld bytes\n", recorder.keyframeCount(), recorder.deltaCount(), (long long)recorder.bytes());
+	}
+	//displaying the ascii visualization is only viable when width and height are small enough
+	//print(ocean);
+
+	float diff((float)t2 - (float)t1);
+	cout << "Parallel processing using OpenMP of a " << width << "x" << height << " grid. Performing " << numberOfSteps << " iterations." << endl;
+	printf("Processing time %f seconds \n", (diff / 1000));
+	printf("using %d threads\n", numOfThreads);
+	if (tile > 1) {
+		printf("using bands of %d rows advanced %d generations at a time\n", band, tile);
+	}
+	cout << "using the " << rowKernelName<cell_t>(kernel) << " kernel with the " << rules << " rules" << endl;
+	for (size_t t = 0; t < scratches.size(); t++) {
+		delete scratches[t];
+	}
+	delete density;
+	system("pause");
+	return 0;
+}
+
+void print(Ocean<cell_t> &ocean) {
+	for (int i = 1; i < ocean.height() + 1; i++) {
+		const cell_t *row = ocean.oldRow(i);
+		for (int j = 1; j < ocean.width() + 1; j++) {
+			//cout << " ";
+			if (row[j] > 0) {
+				cout << "f";// << row[j];
+			}
+			else if (row[j] < 0) {
+				cout << "s";
+			}
+			else {
+				cout << "-";
+			}
+			//cout << " ";
+		}
+		cout << endl;
+	}
+	cout << endl;
+}
+
+pair<int, int> analyze(Ocean<cell_t> &ocean) {
+	int numOfFish = 0;
+	int numOfSharks = 0;
+	for (int i = 1; i <= ocean.height(); i++) {
+		const cell_t *row = ocean.oldRow(i);
+		for (int j = 1; j <= ocean.width(); j++) {
+			if (row[j] < 0) {
+				numOfSharks++;
+			}
+			if (row[j] > 0) {
+				numOfFish++;
+			}
+		}
+	}
+	return pair<int, int>(numOfFish, numOfSharks);
+}
+
+void updateBand(Ocean<cell_t> &ocean, Ocean<cell_t> &scratch, int first, int last, int steps,
+	RowKernel<cell_t>::Function kernel, uint32_t seed, int generation, OceanStats *stats, bool ages, DensityPyramid *density) {
+	//the extra rows are only counted here and dropped
+	OceanStats ignored;
+	ignored.clear();
+	int width = ocean.width();
+	//row r of scratch holds the row top + r of the ocean
+	int top = first - steps;
+	int rows = last - first + 1 + 2 * steps;
+	for (int r = 0; r < rows; r++) {
+		memcpy(scratch.oldRow(r), ocean.oldRow(wrapRow(top + r, ocean.height())), (width + 2) * sizeof(cell_t));
+	}
+	for (int s = 0; s < steps; s++) {
+		//rows s to rows-1-s are valid, the left and right boundaries of the new ones have to be copied again
+		if (s > 0) {
+			for (int r = s; r < rows - s; r++) {
+				cell_t *row = scratch.oldRow(r);
+				row[0] = row[width];
+				row[width + 1] = row[1];
+			}
+		}
+		for (int r = s + 1; r < rows - 1 - s; r++) {
+			//the last generation goes straight into the ocean
+			cell_t *out = s == steps - 1 ? ocean.newRow(top + r) : scratch.newRow(r);
+			//rows steps to rows-1-steps are the rows of the band
+			bool own = r >= steps && r < rows - steps;
+			kernel(scratch.oldRow(r - 1), scratch.oldRow(r), scratch.oldRow(r + 1), out, 1, width,
+				rowRandom(seed, generation + s, wrapRow(top + r, ocean.height()), 0), own ? stats[s] : ignored);
+			if (own && ages) {
+				countAges(out, 1, width, stats[s]);
+			}
+			if (own && density != NULL && s == steps - 1) {
+				density->countCells(top + r, out, 1, width);
+			}
+		}
+		scratch.swap();
+	}
+}
\ No newline at end of file
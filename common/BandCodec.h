@@ -0,0 +1,282 @@
+// BandCodec.h : compresses the cells of an ocean band by band, a band being a few rows that are encoded on their own
+// the occupants of every row are run length encoded (empty, fish or shark) and the ages of the fish and sharks are bit packed after the runs,
+// so the empty regions left by a crash and the uniform regions of fish cost a few bytes, and the bands are shared by several threads
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include "Stats.h"
+
+//rows of a band, the threads take the bands one at a time
+#define CODEC_BAND_ROWS 16
+//longest run, a run is a single byte and longer runs are split
+#define CODEC_RUN_LENGTH 64
+
+//occupant of a run of cells
+enum RunKind {
+	EMPTY_RUN,
+	FISH_RUN,
+	SHARK_RUN
+};
+
+//bits needed to store an age from 1 to ages as age - 1
+inline int ageBits(int ages) {
+	int bits = 0;
+	while ((1 << bits) < ages) {
+		bits++;
+	}
+	return bits;
+}
+
+//compresses and decompresses rows x width cells with a row stride, e.g. a map of Ocean or a block of the hybrid version
+//the compressed cells are the rows of a band, the size of every band, then the bands:
+//every band is the size of its runs, the runs, then the ages
+//a run is the byte (length - 1) << 2 | kind, at most CODEC_RUN_LENGTH cells that never go past the end of a row,
+//the ages are age - 1 for a fish and -age - 1 for a shark, packed lowest bit first in the order of the cells
+class BandCodec {
+public:
+	//threads compress and decompress the bands, 1 keeps all the work on the calling thread
+	explicit BandCodec(int threads = 1) : workers(threads > 0 ? threads : 1) {}
+
+	int threads() const { return workers; }
+
+	//replaces out by the compressed cells
+	template <typename Cell>
+	void compress(const Cell *cells, ptrdiff_t stride, int rows, int width, std::vector<uint8_t> &out) {
+		int bands = (rows + CODEC_BAND_ROWS - 1) / CODEC_BAND_ROWS;
+		if ((int)encoded.size() < bands) {
+			encoded.resize(bands);
+		}
+		forEachBand(bands, [&](int b) {
+			int first = b * CODEC_BAND_ROWS;
+			int count = rows - first < CODEC_BAND_ROWS ? rows - first : CODEC_BAND_ROWS;
+			encodeBand(cells + first * stride, stride, count, width, encoded[b]);
+			return true;
+		});
+		size_t bytes = sizeof(int64_t) * (1 + bands);
+		for (int b = 0; b < bands; b++) {
+			bytes += encoded[b].size();
+		}
+		out.resize(bytes);
+		uint8_t *p = &out[0];
+		int64_t bandRows = CODEC_BAND_ROWS;
+		memcpy(p, &bandRows, sizeof(bandRows));
+		p += sizeof(int64_t);
+		for (int b = 0; b < bands; b++) {
+			int64_t size = (int64_t)encoded[b].size();
+			memcpy(p, &size, sizeof(size));
+			p += sizeof(int64_t);
+		}
+		for (int b = 0; b < bands; b++) {
+			if (!encoded[b].empty()) {
+				memcpy(p, &encoded[b][0], encoded[b].size());
+				p += encoded[b].size();
+			}
+		}
+	}
+
+	//writes the cells compressed in data back to rows x width cells with a row stride
+	//returns false when data is not rows x width compressed cells, the cells are then left half written
+	template <typename Cell>
+	bool decompress(const uint8_t *data, size_t bytes, Cell *cells, ptrdiff_t stride, int rows, int width) {
+		int64_t bandRows;
+		if (bytes < sizeof(bandRows)) {
+			return false;
+		}
+		memcpy(&bandRows, data, sizeof(bandRows));
+		if (bandRows <= 0) {
+			return false;
+		}
+		int bands = (int)((rows + bandRows - 1) / bandRows);
+		if (bytes < sizeof(int64_t) * (1 + (size_t)bands)) {
+			return false;
+		}
+		//where every band starts, from the sizes after the rows of a band
+		std::vector<size_t> starts(bands + 1);
+		starts[0] = sizeof(int64_t) * (1 + (size_t)bands);
+		for (int b = 0; b < bands; b++) {
+			int64_t size;
+			memcpy(&size, data + sizeof(int64_t) * (1 + b), sizeof(size));
+			if (size < 0 || (uint64_t)size > bytes - starts[b]) {
+				return false;
+			}
+			starts[b + 1] = starts[b] + (size_t)size;
+		}
+		if (starts[bands] != bytes) {
+			return false;
+		}
+		return forEachBand(bands, [&](int b) {
+			int first = (int)(b * bandRows);
+			int count = rows - first < bandRows ? rows - first : (int)bandRows;
+			return decodeBand(data + starts[b], starts[b + 1] - starts[b], cells + first * stride, stride, count, width);
+		});
+	}
+
+private:
+	//encodes rows x width cells into out, the size of the runs, the runs, then the ages
+	//there is at most a run per cell, so the runs are written in front and the ages after room for a run per cell,
+	//then the ages are moved down behind the runs
+	//every cell goes through the same steps whatever its occupant, so the short runs of a mixed ocean cost no mispredicted branches
+	template <typename Cell>
+	void encodeBand(const Cell *cells, ptrdiff_t stride, int rows, int width, std::vector<uint8_t> &out) {
+		//bits of the age and mask of age - 1 for every kind of run, an empty cell adds nothing
+		const int bits[4] = { 0, ageBits(FISH_AGES), ageBits(SHARK_AGES), 0 };
+		const int masks[4] = { 0, (1 << bits[FISH_RUN]) - 1, (1 << bits[SHARK_RUN]) - 1, 0 };
+		size_t count = (size_t)rows * width;
+		size_t ageRoom = (count * (bits[SHARK_RUN] > bits[FISH_RUN] ? bits[SHARK_RUN] : bits[FISH_RUN]) + 7) / 8 + 8;
+		out.resize(sizeof(int64_t) + count + ageRoom);
+		uint8_t *runs = &out[0] + sizeof(int64_t);
+		uint8_t *ages = runs + count;
+		uint8_t *age = ages;
+		uint64_t buffer = 0;
+		int used = 0;
+		for (int i = 0; i < rows && width > 0; i++) {
+			const Cell *row = cells + i * stride;
+			int previous = (row[0] > 0) | ((row[0] < 0) << 1);
+			int length = 0;
+			for (int j = 0; j < width; j++) {
+				int cell = row[j];
+				int kind = (cell > 0) | ((cell < 0) << 1);
+				//the run before this cell ends when the occupant changes, it is always written and only kept when it ends
+				int ends = kind != previous;
+				*runs = (uint8_t)(((length - 1) << 2) | previous);
+				runs += ends;
+				length = (length & (ends - 1)) + 1;
+				previous = kind;
+				//a run longer than a run can be is cut, the cells before this one make a whole run
+				if (length > CODEC_RUN_LENGTH) {
+					*runs++ = (uint8_t)(((CODEC_RUN_LENGTH - 1) << 2) | kind);
+					length = 1;
+				}
+				int value = (cell < 0 ? -cell : cell) - 1;
+				buffer |= (uint64_t)(value & masks[kind]) << used;
+				used += bits[kind];
+				//the low 32 bits are always written and only kept once they are full, there are never more than 32 + bits waiting
+				age[0] = (uint8_t)buffer;
+				age[1] = (uint8_t)(buffer >> 8);
+				age[2] = (uint8_t)(buffer >> 16);
+				age[3] = (uint8_t)(buffer >> 24);
+				int full = used >> 5;
+				age += 4 * full;
+				buffer >>= 32 * full;
+				used -= 32 * full;
+			}
+			*runs++ = (uint8_t)(((length - 1) << 2) | previous);
+		}
+		for (; used > 0; used -= 8) {
+			*age++ = (uint8_t)buffer;
+			buffer >>= 8;
+		}
+		int64_t runBytes = runs - (&out[0] + sizeof(int64_t));
+		memcpy(&out[0], &runBytes, sizeof(runBytes));
+		memmove(runs, ages, age - ages);
+		out.resize(sizeof(int64_t) + runBytes + (age - ages));
+	}
+
+	//the opposite of encodeBand, returns false when data does not hold exactly rows x width cells
+	template <typename Cell>
+	bool decodeBand(const uint8_t *data, size_t bytes, Cell *cells, ptrdiff_t stride, int rows, int width) {
+		int fishBits = ageBits(FISH_AGES);
+		int sharkBits = ageBits(SHARK_AGES);
+		const uint8_t *end = data + bytes;
+		const uint8_t *p = data;
+		int64_t runBytes;
+		if (bytes < sizeof(runBytes)) {
+			return false;
+		}
+		memcpy(&runBytes, p, sizeof(runBytes));
+		p += sizeof(runBytes);
+		if (runBytes < 0 || (uint64_t)runBytes > (uint64_t)(end - p)) {
+			return false;
+		}
+		const uint8_t *runEnd = p + runBytes;
+		const uint8_t *age = runEnd;
+		uint64_t buffer = 0;
+		int used = 0;
+		for (int i = 0; i < rows; i++) {
+			Cell *row = cells + i * stride;
+			int j = 0;
+			while (j < width) {
+				if (p == runEnd) {
+					return false;
+				}
+				int run = *p++;
+				int kind = run & 3;
+				int last = j + (run >> 2);
+				if (last >= width) {
+					return false;
+				}
+				if (kind == EMPTY_RUN) {
+					for (; j <= last; j++) {
+						row[j] = 0;
+					}
+					continue;
+				}
+				if (kind != FISH_RUN && kind != SHARK_RUN) {
+					return false;
+				}
+				int bits = kind == FISH_RUN ? fishBits : sharkBits;
+				int ages = kind == FISH_RUN ? FISH_AGES : SHARK_AGES;
+				uint64_t mask = ((uint64_t)1 << bits) - 1;
+				for (; j <= last; j++) {
+					while (used < bits) {
+						if (age == end) {
+							return false;
+						}
+						buffer |= (uint64_t)*age++ << used;
+						used += 8;
+					}
+					int value = (int)(buffer & mask) + 1;
+					buffer >>= bits;
+					used -= bits;
+					if (value > ages) {
+						return false;
+					}
+					row[j] = (Cell)(kind == FISH_RUN ? value : -value);
+				}
+			}
+		}
+		return p == runEnd && age == end;
+	}
+
+	//calls work(b) for every band b on the threads of the codec, returns false when one of the calls did
+	template <typename Work>
+	bool forEachBand(int bands, Work work) {
+		int count = workers < bands ? workers : bands;
+		if (count <= 1) {
+			for (int b = 0; b < bands; b++) {
+				if (!work(b)) {
+					return false;
+				}
+			}
+			return true;
+		}
+		std::atomic<int> next(0);
+		std::atomic<bool> ok(true);
+		auto take = [&]() {
+			for (int b = next++; b < bands; b = next++) {
+				if (!work(b)) {
+					ok = false;
+				}
+			}
+		};
+		std::vector<std::thread> helpers;
+		for (int t = 1; t < count; t++) {
+			helpers.push_back(std::thread(take));
+		}
+		take();
+		for (size_t t = 0; t < helpers.size(); t++) {
+			helpers[t].join();
+		}
+		return ok;
+	}
+
+	int workers;
+	//the bands of compress, kept from one call to the next
+	std::vector<std::vector<uint8_t> > encoded;
+};
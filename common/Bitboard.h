@@ -0,0 +1,589 @@
+// Bitboard.h : an engine that stores the ocean as bit planes, 64 cells per machine word
+// the neighbors are counted with bitwise adders on whole words, and the ages are kept apart as
+// bit-sliced counters that are only needed for the old age deaths
+// the same code runs on 64 bit words, or on 256 bit AVX2 vectors when the processor supports it
+// and like the row kernels it is a template on the rules (see Rules.h)
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include "Ocean.h"
+#include "Cpu.h"
+#include "Kernel.h"
+#include "Random.h"
+#include "Rules.h"
+#include "DensityPyramid.h"
+
+//position of the lowest set bit of a non zero word
+inline int lowestBit(uint64_t word) {
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return (int)index;
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if ((uint32_t)word != 0) {
+		_BitScanForward(&index, (uint32_t)word);
+		return (int)index;
+	}
+	_BitScanForward(&index, (uint32_t)(word >> 32));
+	return (int)index + 32;
+#else
+	return __builtin_ctzll(word);
+#endif
+}
+
+//the planes stored for every row, the adult ages are the same as in evaluate (see Kernel.h)
+//only the first four are counted around every cell, the age planes are only read for the cell itself
+enum BitPlane {
+	FISH_PLANE,        //a fish of any age
+	ADULT_FISH_PLANE,  //a fish of age 2 or more
+	SHARK_PLANE,       //a shark of any age
+	ADULT_SHARK_PLANE, //a shark of age 3 or more
+	AGE_PLANE,         //bit 0 of the age of the fish or shark, the next planes hold the higher bits
+	PLANES = AGE_PLANE + 5
+};
+
+//a shark lives up to 20 generations, so 5 bits are enough for every age
+#define AGE_BITS (PLANES - AGE_PLANE)
+
+//the bits counted by the engine for the statistics (see Stats.h), the ages are counted one bit plane at a time
+enum BitTally {
+	TALLY_FISH,
+	TALLY_SHARKS,
+	TALLY_FISH_BORN,
+	TALLY_SHARKS_BORN,
+	TALLY_EATEN,
+	TALLY_OVERCROWDED,
+	TALLY_FISH_OLD_AGE,
+	TALLY_STARVED,
+	TALLY_HEART_ATTACKS,
+	TALLY_SHARK_OLD_AGE,
+	TALLY_FISH_AGE,
+	TALLY_SHARK_AGE = TALLY_FISH_AGE + AGE_BITS,
+	TALLIES = TALLY_SHARK_AGE + AGE_BITS
+};
+
+//zero words kept before and after every plane of a row, so the neighbors of the first and last
+//word can be read without a special case, 4 words keep the planes aligned for AVX2
+#define GUARD_WORDS 4
+
+//one bit per column column..column+63, set when the shark in that column has a heart attack, that is when its random number is below threshold
+//the random numbers are the same as the ones of the row kernels, and only drawn for the sharks
+inline uint64_t heartAttackWord(const RowRandom &random, int column, uint64_t sharks, uint32_t threshold) {
+	uint64_t attacks = 0;
+	for (; sharks != 0; sharks &= sharks - 1) {
+		int b = lowestBit(sharks);
+		if (random.at(column + b) < threshold) {
+			attacks |= 1ull << b;
+		}
+	}
+	return attacks;
+}
+
+//the operations the engine needs on a word of cells, 64 cells in a uint64_t
+struct BitOps64 {
+	typedef uint64_t Word;
+	enum { words = 1 };
+	static Word load(const uint64_t *p) { return *p; }
+	static void store(uint64_t *p, const Word &x) { *p = x; }
+	//bit j of west is the cell to the left of cell j, bit j of east the cell to its right
+	static Word west(const uint64_t *p) { return (p[0] << 1) | (p[-1] >> 63); }
+	static Word east(const uint64_t *p) { return (p[0] >> 1) | (p[1] << 63); }
+	static bool any(const Word &x) { return x != 0; }
+	//a running count of set bits
+	typedef int64_t Count;
+	static Count noCount() { return 0; }
+	static void count(Count &c, const Word &x) { c += bitCount(x); }
+	static int64_t total(const Count &c) { return c; }
+	static Word heartAttacks(const RowRandom &random, int column, const Word &sharks, uint32_t threshold) {
+		return heartAttackWord(random, column, sharks, threshold);
+	}
+};
+
+#ifdef OCEAN_X86
+
+//256 cells in an AVX2 vector, with the bitwise operators of an integer
+struct Bits256 {
+	__m256i v;
+};
+
+AVX2_TARGET inline Bits256 operator&(const Bits256 &a, const Bits256 &b) { Bits256 r; r.v = _mm256_and_si256(a.v, b.v); return r; }
+AVX2_TARGET inline Bits256 operator|(const Bits256 &a, const Bits256 &b) { Bits256 r; r.v = _mm256_or_si256(a.v, b.v); return r; }
+AVX2_TARGET inline Bits256 operator^(const Bits256 &a, const Bits256 &b) { Bits256 r; r.v = _mm256_xor_si256(a.v, b.v); return r; }
+AVX2_TARGET inline Bits256 operator~(const Bits256 &a) { Bits256 r; r.v = _mm256_xor_si256(a.v, _mm256_set1_epi32(-1)); return r; }
+
+//the operations the engine needs on 4 words at once
+struct BitOpsAvx2 {
+	typedef Bits256 Word;
+	enum { words = 4 };
+	static AVX2_TARGET Word load(const uint64_t *p) { Word r; r.v = _mm256_load_si256((const __m256i *)p); return r; }
+	static AVX2_TARGET void store(uint64_t *p, const Word &x) { _mm256_store_si256((__m256i *)p, x.v); }
+	//the bit that crosses from the previous (or next) word comes from a load shifted by one word
+	static AVX2_TARGET Word west(const uint64_t *p) {
+		Word r;
+		r.v = _mm256_or_si256(_mm256_slli_epi64(_mm256_load_si256((const __m256i *)p), 1),
+			_mm256_srli_epi64(_mm256_loadu_si256((const __m256i *)(p - 1)), 63));
+		return r;
+	}
+	static AVX2_TARGET Word east(const uint64_t *p) {
+		Word r;
+		r.v = _mm256_or_si256(_mm256_srli_epi64(_mm256_load_si256((const __m256i *)p), 1),
+			_mm256_slli_epi64(_mm256_loadu_si256((const __m256i *)(p + 1)), 63));
+		return r;
+	}
+	static AVX2_TARGET bool any(const Word &x) { return _mm256_testz_si256(x.v, x.v) == 0; }
+	//4 running 64 bit counts, the bits of every byte are counted with a lookup of each half byte
+	typedef Bits256 Count;
+	static AVX2_TARGET Count noCount() { Count c; c.v = _mm256_setzero_si256(); return c; }
+	static AVX2_TARGET void count(Count &c, const Word &x) {
+		const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+			0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+		const __m256i low = _mm256_set1_epi8(0x0F);
+		__m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(table, _mm256_and_si256(x.v, low)),
+			_mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(x.v, 4), low)));
+		c.v = _mm256_add_epi64(c.v, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+	}
+	static AVX2_TARGET int64_t total(const Count &c) {
+		int64_t sums[4];
+		_mm256_storeu_si256((__m256i *)sums, c.v);
+		return sums[0] + sums[1] + sums[2] + sums[3];
+	}
+	static AVX2_TARGET Word heartAttacks(const RowRandom &random, int column, const Word &sharks, uint32_t threshold) {
+		//only a few cells hold a shark, drawing their random numbers one by one is as fast as drawing all 256 with AVX2
+		uint64_t words[4];
+		_mm256_storeu_si256((__m256i *)words, sharks.v);
+		for (int q = 0; q < 4; q++) {
+			words[q] = heartAttackWord(random, column + 64 * q, words[q], threshold);
+		}
+		Word r;
+		r.v = _mm256_loadu_si256((const __m256i *)words);
+		return r;
+	}
+};
+
+#endif
+
+//adds three bit planes, every bit position is a separate 1 bit addition
+template <typename Word>
+inline void fullAdd(const Word &a, const Word &b, const Word &c, Word &sum, Word &carry) {
+	Word partial = a ^ b;
+	sum = partial ^ c;
+	carry = (a & b) | (partial & c);
+}
+
+template <typename Word>
+inline void halfAdd(const Word &a, const Word &b, Word &sum, Word &carry) {
+	sum = a ^ b;
+	carry = a & b;
+}
+
+//mask of the cells whose bit-sliced number (bit b of every cell in bits[b]) is at least n
+//the number is compared from its lowest bit up, n is a constant so the tests on its bits are folded away
+//and only the ands and ors the bits of n call for are left
+template <int n, typename Word>
+inline Word atLeastBits(const Word *bits, int count) {
+	Word result = bits[0];
+	//as long as the low bits of n are all 0, every number is at least as large
+	bool any = true;
+	for (int b = 0; b < count; b++) {
+		if ((n >> b) & 1) {
+			result = any ? bits[b] : bits[b] & result;
+			any = false;
+		}
+		else if (!any) {
+			result = bits[b] | result;
+		}
+	}
+	return any ? bits[0] | ~bits[0] : result;
+}
+
+//the number of neighbors (0 to 8) of every cell of a word, spread over the bits of the same
+//position in ones, twos, fours and eights
+template <typename Word>
+struct BitCount {
+	Word ones;
+	Word twos;
+	Word fours;
+	Word eights;
+
+	//mask of the cells whose count is at least n
+	template <int n>
+	Word atLeast() const {
+		const Word bits[4] = { ones, twos, fours, eights };
+		return atLeastBits<n>(bits, 4);
+	}
+	Word isZero() const { return ~(eights | fours | twos | ones); }
+};
+
+//counts the 8 neighbors of the cells in one word of a plane, given the same word of the plane in the rows above, here and below
+template <typename Ops>
+inline BitCount<typename Ops::Word> countNeighbors(const uint64_t *above, const uint64_t *here, const uint64_t *below) {
+	typedef typename Ops::Word Word;
+	Word a1, a2, b1, b2, c1, c2, d2, e2, e4, f4;
+	BitCount<Word> count;
+	fullAdd(Ops::west(above), Ops::west(here), Ops::west(below), a1, a2);
+	fullAdd(Ops::load(above), Ops::load(below), Ops::east(above), b1, b2);
+	halfAdd(Ops::east(here), Ops::east(below), c1, c2);
+	fullAdd(a1, b1, c1, count.ones, d2);
+	fullAdd(a2, b2, c2, e2, e4);
+	halfAdd(e2, d2, count.twos, f4);
+	halfAdd(e4, f4, count.fours, count.eights);
+	return count;
+}
+
+//the cells that are adults in the next generation, among the survivors of their kind and the newborns
+//every survivor is at least 1, so for an adult age of 2 the ages do not have to be looked at
+template <int adultAge, typename Word>
+inline Word adults(const Word &lives, const Word &born, const Word *age) {
+	Word result = adultAge <= 2 ? lives : lives & atLeastBits<adultAge - 1>(age, AGE_BITS);
+	return adultAge <= 1 ? result | born : result;
+}
+
+//computes one row of the next generation, planes are planeStride words apart in every row
+//mask has the bits of the real cells of the row, words is a multiple of Ops::words
+//what happened to the cells of the row is added to stats
+template <typename Ops, typename Rules>
+inline void updateBitRow(const uint64_t *above, const uint64_t *here, const uint64_t *below, uint64_t *next,
+	const uint64_t *mask, int planeStride, int words, const RowRandom &random, OceanStats &stats) {
+	typedef typename Ops::Word Word;
+	typename Ops::Count tally[TALLIES];
+	for (int t = 0; t < TALLIES; t++) {
+		tally[t] = Ops::noCount();
+	}
+	for (int k = 0; k < words; k += Ops::words) {
+		BitCount<Word> fish = countNeighbors<Ops>(above + FISH_PLANE * planeStride + k, here + FISH_PLANE * planeStride + k, below + FISH_PLANE * planeStride + k);
+		BitCount<Word> adultFish = countNeighbors<Ops>(above + ADULT_FISH_PLANE * planeStride + k, here + ADULT_FISH_PLANE * planeStride + k, below + ADULT_FISH_PLANE * planeStride + k);
+		BitCount<Word> sharks = countNeighbors<Ops>(above + SHARK_PLANE * planeStride + k, here + SHARK_PLANE * planeStride + k, below + SHARK_PLANE * planeStride + k);
+		BitCount<Word> adultSharks = countNeighbors<Ops>(above + ADULT_SHARK_PLANE * planeStride + k, here + ADULT_SHARK_PLANE * planeStride + k, below + ADULT_SHARK_PLANE * planeStride + k);
+
+		//the copies of the boundary columns are left out, so they are neither updated nor counted
+		Word real = Ops::load(mask + k);
+		Word isFish = Ops::load(here + FISH_PLANE * planeStride + k) & real;
+		Word isShark = Ops::load(here + SHARK_PLANE * planeStride + k) & real;
+		Word isEmpty = ~(isFish | isShark) & real;
+		Word age[AGE_BITS];
+		for (int b = 0; b < AGE_BITS; b++) {
+			age[b] = Ops::load(here + (AGE_PLANE + b) * planeStride + k);
+		}
+		//the ages at which a fish and a shark die of old age
+		Word fishOldAge = atLeastBits<Rules::FISH_MAX_AGE>(age, AGE_BITS);
+		Word sharkOldAge = atLeastBits<Rules::SHARK_MAX_AGE>(age, AGE_BITS);
+
+		//a fish dies by being eaten, overpopulation, or old age
+		Word eaten = isFish & sharks.template atLeast<Rules::SHARKS_TO_EAT>();
+		Word overcrowded = isFish & ~eaten & fish.template atLeast<Rules::FISH_TO_OVERCROWD>();
+		Word fishOld = isFish & ~(eaten | overcrowded) & fishOldAge;
+		Word fishLives = isFish & ~(eaten | overcrowded | fishOld);
+		//a shark dies by starvation, randomly, or old age, the random numbers are drawn for the sharks that did not starve
+		Word starved = isShark & sharks.template atLeast<Rules::SHARKS_TO_STARVE>() & fish.isZero();
+		Word sharkLives = isShark & ~starved;
+		Word heartAttacks = sharkLives & ~sharkLives;
+		if (Ops::any(sharkLives)) {
+			heartAttacks = Ops::heartAttacks(random, k * 64, sharkLives, Rules::heartAttackThreshold());
+		}
+		Word sharkOld = sharkLives & ~heartAttacks & sharkOldAge;
+		sharkLives = sharkLives & ~(heartAttacks | sharkOldAge);
+		//breeding rules, a fish birth takes precedence over a shark birth
+		Word fishBorn = isEmpty & fish.template atLeast<Rules::FISH_TO_BREED>() & adultFish.template atLeast<Rules::ADULT_FISH_TO_BREED>()
+			& ~sharks.template atLeast<Rules::FISH_BREED_MAX_SHARKS + 1>();
+		Word sharkBorn = isEmpty & ~fishBorn & sharks.template atLeast<Rules::SHARKS_TO_BREED>() & adultSharks.template atLeast<Rules::ADULT_SHARKS_TO_BREED>()
+			& ~fish.template atLeast<Rules::SHARK_BREED_MAX_FISH + 1>();
+		Ops::count(tally[TALLY_EATEN], eaten);
+		Ops::count(tally[TALLY_OVERCROWDED], overcrowded);
+		Ops::count(tally[TALLY_FISH_OLD_AGE], fishOld);
+		Ops::count(tally[TALLY_STARVED], starved);
+		Ops::count(tally[TALLY_HEART_ATTACKS], heartAttacks);
+		Ops::count(tally[TALLY_SHARK_OLD_AGE], sharkOld);
+		Ops::count(tally[TALLY_FISH_BORN], fishBorn);
+		Ops::count(tally[TALLY_SHARKS_BORN], sharkBorn);
+		Ops::count(tally[TALLY_FISH], fishLives | fishBorn);
+		Ops::count(tally[TALLY_SHARKS], sharkLives | sharkBorn);
+
+		Ops::store(next + FISH_PLANE * planeStride + k, fishLives | fishBorn);
+		Ops::store(next + SHARK_PLANE * planeStride + k, sharkLives | sharkBorn);
+		//a survivor is an adult when it was one generation short of the adult age, a newborn is 1
+		Ops::store(next + ADULT_FISH_PLANE * planeStride + k, adults<Rules::FISH_ADULT_AGE>(fishLives, fishBorn, age));
+		Ops::store(next + ADULT_SHARK_PLANE * planeStride + k, adults<Rules::SHARK_ADULT_AGE>(sharkLives, sharkBorn, age));
+
+		//the survivors get 1 generation older, the newborns start at 1 and the other cells at 0
+		Word survivors = fishLives | sharkLives;
+		Word carry = survivors;
+		for (int b = 0; b < AGE_BITS; b++) {
+			Word bit = (age[b] & survivors) ^ carry;
+			if (b == 0) {
+				bit = bit | fishBorn | sharkBorn;
+			}
+			carry = carry & age[b];
+			Ops::store(next + (AGE_PLANE + b) * planeStride + k, bit);
+			Ops::count(tally[TALLY_FISH_AGE + b], bit & (fishLives | fishBorn));
+			Ops::count(tally[TALLY_SHARK_AGE + b], bit & (sharkLives | sharkBorn));
+		}
+	}
+
+	OceanStats row;
+	row.clear();
+	row.fish = Ops::total(tally[TALLY_FISH]);
+	row.sharks = Ops::total(tally[TALLY_SHARKS]);
+	row.fishBorn = Ops::total(tally[TALLY_FISH_BORN]);
+	row.sharksBorn = Ops::total(tally[TALLY_SHARKS_BORN]);
+	row.eaten = Ops::total(tally[TALLY_EATEN]);
+	row.overcrowded = Ops::total(tally[TALLY_OVERCROWDED]);
+	row.fishOldAge = Ops::total(tally[TALLY_FISH_OLD_AGE]);
+	row.starved = Ops::total(tally[TALLY_STARVED]);
+	row.heartAttacks = Ops::total(tally[TALLY_HEART_ATTACKS]);
+	row.sharkOldAge = Ops::total(tally[TALLY_SHARK_OLD_AGE]);
+	for (int b = 0; b < AGE_BITS; b++) {
+		row.fishAges += Ops::total(tally[TALLY_FISH_AGE + b]) << b;
+		row.sharkAges += Ops::total(tally[TALLY_SHARK_AGE + b]) << b;
+	}
+	stats.add(row);
+}
+
+//the engine on 64 bit words, and on AVX2 vectors, with the rules compiled in
+template <typename Rules>
+inline void updateBitRow64(const uint64_t *above, const uint64_t *here, const uint64_t *below, uint64_t *next,
+	const uint64_t *mask, int planeStride, int words, const RowRandom &random, OceanStats &stats) {
+	updateBitRow<BitOps64, Rules>(above, here, below, next, mask, planeStride, words, random, stats);
+}
+
+#ifdef OCEAN_X86
+template <typename Rules>
+AVX2_FLATTEN inline void updateBitRowAvx2(const uint64_t *above, const uint64_t *here, const uint64_t *below, uint64_t *next,
+	const uint64_t *mask, int planeStride, int words, const RowRandom &random, OceanStats &stats) {
+	updateBitRow<BitOpsAvx2, Rules>(above, here, below, next, mask, planeStride, words, random, stats);
+}
+#endif
+
+//a row function of the engine
+typedef void(*BitRowFunction)(const uint64_t *above, const uint64_t *here, const uint64_t *below, uint64_t *next,
+	const uint64_t *mask, int planeStride, int words, const RowRandom &random, OceanStats &stats);
+
+//finds the row function and the adult ages of the rule set called name
+struct BitRulesFinder {
+	const char *name;
+	bool avx2;
+	BitRowFunction function;
+	int fishAdultAge;
+	int sharkAdultAge;
+	template <typename Rules>
+	void use() {
+		if (function != NULL || strcmp(name, Rules::name()) != 0) {
+			return;
+		}
+#ifdef OCEAN_X86
+		function = avx2 ? &updateBitRowAvx2<Rules> : &updateBitRow64<Rules>;
+#else
+		function = &updateBitRow64<Rules>;
+#endif
+		fishAdultAge = Rules::FISH_ADULT_AGE;
+		sharkAdultAge = Rules::SHARK_ADULT_AGE;
+	}
+};
+
+//the ocean as double-buffered bit planes
+//like in Ocean, every row has an extra column at each end (bits 0 and width+1) and there is an
+//extra row above and below, so cells go from 1 to height and 1 to width
+class BitOcean {
+public:
+	//the AVX2 version is used when the processor supports it, unless forceScalar is set
+	//rules is the name of a rule set (see Rules.h), the standard rules are used when there is no such rule set
+	BitOcean(int height, int width, bool forceScalar, const char *rules) : h(height), w(width) {
+		//whole AVX2 vectors, the words past the last cell stay empty
+		rowWords = ((w + 2 + 255) / 256) * 4;
+		planeStride = rowWords + 2 * GUARD_WORDS;
+		size_t bytes = (size_t)(h + 2) * PLANES * planeStride * sizeof(uint64_t);
+		oldBits = (uint64_t *)oceanAlloc(bytes);
+		newBits = (uint64_t *)oceanAlloc(bytes);
+		memset(oldBits, 0, bytes);
+		memset(newBits, 0, bytes);
+		mask = (uint64_t *)oceanAlloc(rowWords * sizeof(uint64_t));
+		memset(mask, 0, rowWords * sizeof(uint64_t));
+		for (int j = 1; j <= w; j++) {
+			setBit(mask, j, true);
+		}
+#ifdef OCEAN_X86
+		avx2 = !forceScalar && cpuHasAvx2();
+#else
+		avx2 = false;
+#endif
+		BitRulesFinder finder = { knownRules(rules) ? rules : DEFAULT_RULES, avx2, NULL, 0, 0 };
+		forEachRules(finder);
+		rowFunction = finder.function;
+		fishAdultAge = finder.fishAdultAge;
+		sharkAdultAge = finder.sharkAdultAge;
+	}
+
+	~BitOcean() {
+		oceanFree(oldBits);
+		oceanFree(newBits);
+		oceanFree(mask);
+	}
+
+	int height() const { return h; }
+	int width() const { return w; }
+	//name of the version in use, to be displayed
+	const char *name() const { return avx2 ? "AVX2 bitboard" : "bitboard"; }
+
+	//plane p of row i (0 to height+1) of the current generation
+	uint64_t *oldPlane(int i, int p) { return oldBits + ((size_t)i * PLANES + p) * planeStride + GUARD_WORDS; }
+	const uint64_t *oldPlane(int i, int p) const { return oldBits + ((size_t)i * PLANES + p) * planeStride + GUARD_WORDS; }
+	//plane p of row i of the generation being computed
+	uint64_t *newPlane(int i, int p) { return newBits + ((size_t)i * PLANES + p) * planeStride + GUARD_WORDS; }
+
+	//converts the current generation of an ocean into bit planes
+	template <typename Cell>
+	void load(const Ocean<Cell> &ocean) {
+		memset(oldBits, 0, (size_t)(h + 2) * PLANES * planeStride * sizeof(uint64_t));
+		for (int i = 1; i <= h; i++) {
+			const Cell *row = ocean.oldRow(i);
+			for (int j = 1; j <= w; j++) {
+				int value = row[j];
+				int age = value < 0 ? -value : value;
+				setBit(oldPlane(i, FISH_PLANE), j, value > 0);
+				setBit(oldPlane(i, ADULT_FISH_PLANE), j, value >= fishAdultAge);
+				setBit(oldPlane(i, SHARK_PLANE), j, value < 0);
+				setBit(oldPlane(i, ADULT_SHARK_PLANE), j, -value >= sharkAdultAge);
+				for (int b = 0; b < AGE_BITS; b++) {
+					setBit(oldPlane(i, AGE_PLANE + b), j, ((age >> b) & 1) != 0);
+				}
+			}
+		}
+	}
+
+	//writes the current generation back into the current map of an ocean, e.g. to print it
+	template <typename Cell>
+	void store(Ocean<Cell> &ocean) const {
+		for (int i = 1; i <= h; i++) {
+			Cell *row = ocean.oldRow(i);
+			for (int j = 1; j <= w; j++) {
+				int age = 0;
+				for (int b = 0; b < AGE_BITS; b++) {
+					age |= (getBit(oldPlane(i, AGE_PLANE + b), j) ? 1 : 0) << b;
+				}
+				row[j] = (Cell)(getBit(oldPlane(i, SHARK_PLANE), j) ? -age : age);
+			}
+		}
+	}
+
+	//copies the edges of the current planes into the extra rows and columns, same as Ocean::wrapBoundaries
+	void wrapBoundaries() {
+		for (int i = 1; i <= h; i++) {
+			for (int p = 0; p < PLANES; p++) {
+				uint64_t *row = oldPlane(i, p);
+				setBit(row, 0, getBit(row, w));
+				setBit(row, w + 1, getBit(row, 1));
+			}
+		}
+		//the guard words are zero in every row, so they can be copied along
+		memcpy(oldPlane(0, 0), oldPlane(h, 0), ((size_t)PLANES * planeStride - 2 * GUARD_WORDS) * sizeof(uint64_t));
+		memcpy(oldPlane(h + 1, 0), oldPlane(1, 0), ((size_t)PLANES * planeStride - 2 * GUARD_WORDS) * sizeof(uint64_t));
+	}
+
+	//computes row i of the next generation, random holds the random numbers of this row in this generation
+	//and what happened to the cells of the row is added to stats
+	void updateRow(int i, const RowRandom &random, OceanStats &stats) {
+		rowFunction(oldPlane(i - 1, 0), oldPlane(i, 0), oldPlane(i + 1, 0), newPlane(i, 0), mask, planeStride, rowWords, random, stats);
+	}
+
+	//makes the generation that was just written into the new planes the current one
+	void swap() {
+		uint64_t *temp = oldBits;
+		oldBits = newBits;
+		newBits = temp;
+	}
+
+	//adds the ages of row i of the generation just computed to the histograms of stats (see Stats.h)
+	//the cells of an age are the ones whose age bits all match the bits of that age
+	void countAges(int i, OceanStats &stats) {
+		for (int k = 0; k < rowWords; k++) {
+			uint64_t fish = newPlane(i, FISH_PLANE)[k] & mask[k];
+			uint64_t sharks = newPlane(i, SHARK_PLANE)[k] & mask[k];
+			if ((fish | sharks) == 0) {
+				continue;
+			}
+			uint64_t age[AGE_BITS];
+			for (int b = 0; b < AGE_BITS; b++) {
+				age[b] = newPlane(i, AGE_PLANE + b)[k];
+			}
+			for (int a = 1; a <= SHARK_AGES; a++) {
+				uint64_t same = ~0ull;
+				for (int b = 0; b < AGE_BITS; b++) {
+					same &= ((a >> b) & 1) ? age[b] : ~age[b];
+				}
+				if (a <= FISH_AGES) {
+					stats.fishOfAge[a - 1] += bitCount(same & fish);
+				}
+				stats.sharksOfAge[a - 1] += bitCount(same & sharks);
+			}
+		}
+	}
+
+	//counts the fish and sharks of row i of the generation just computed into the tiles of density (see DensityPyramid.h),
+	//a tile is a few bits of the fish and shark planes
+	void countDensity(int i, DensityPyramid &density) {
+		const uint64_t *fish = newPlane(i, FISH_PLANE);
+		const uint64_t *sharks = newPlane(i, SHARK_PLANE);
+		for (int first = 1, tile = 0; first <= w; first += PYRAMID_TILE, tile++) {
+			int last = first + PYRAMID_TILE - 1 < w ? first + PYRAMID_TILE - 1 : w;
+			density.add(i, tile, countBits(fish, first, last), countBits(sharks, first, last));
+		}
+	}
+
+	//number of fish and sharks in rows first..last of the current generation
+	void count(int first, int last, int &fish, int &sharks) const {
+		fish = 0;
+		sharks = 0;
+		for (int i = first; i <= last; i++) {
+			for (int k = 0; k < rowWords; k++) {
+				fish += bitCount(oldPlane(i, FISH_PLANE)[k] & mask[k]);
+				sharks += bitCount(oldPlane(i, SHARK_PLANE)[k] & mask[k]);
+			}
+		}
+	}
+
+private:
+	//the planes are owned, so the ocean cannot be copied
+	BitOcean(const BitOcean &);
+	BitOcean &operator=(const BitOcean &);
+
+	//number of bits first to last of a row that are set
+	static int countBits(const uint64_t *row, int first, int last) {
+		int count = 0;
+		for (int k = first >> 6; k <= last >> 6; k++) {
+			uint64_t word = row[k];
+			if (k == first >> 6) {
+				word &= ~0ull << (first & 63);
+			}
+			if (k == last >> 6) {
+				word &= ~0ull >> (63 - (last & 63));
+			}
+			count += bitCount(word);
+		}
+		return count;
+	}
+	static bool getBit(const uint64_t *row, int j) { return ((row[j >> 6] >> (j & 63)) & 1) != 0; }
+	static void setBit(uint64_t *row, int j, bool value) {
+		uint64_t bit = 1ull << (j & 63);
+		row[j >> 6] = value ? (row[j >> 6] | bit) : (row[j >> 6] & ~bit);
+	}
+
+	int h;
+	int w;
+	//number of words in one plane of a row, and between the start of two consecutive planes
+	int rowWords;
+	int planeStride;
+	bool avx2;
+	//the row function of the rule set, and its adult ages for load
+	BitRowFunction rowFunction;
+	int fishAdultAge;
+	int sharkAdultAge;
+	uint64_t *oldBits;
+	uint64_t *newBits;
+	//the bits of the real cells (columns 1 to width) of a row
+	uint64_t *mask;
+};
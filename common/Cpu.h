@@ -0,0 +1,45 @@
+// Cpu.h : instruction set detection shared by the vectorized kernels
+
+#pragma once
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define OCEAN_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+//gcc and clang only emit AVX2 instructions inside functions marked for it, msvc always can
+//AVX2_FLATTEN also inlines everything the function calls, so a generic template called from it
+//is compiled with AVX2 as well and can inline the AVX2 operations it is given
+#if defined(OCEAN_X86) && (defined(__GNUC__) || defined(__clang__))
+#define AVX2_TARGET __attribute__((target("avx2")))
+#define AVX2_FLATTEN __attribute__((target("avx2"), flatten))
+#else
+#define AVX2_TARGET
+#define AVX2_FLATTEN
+#endif
+
+//true when the processor and the operating system both support AVX2
+inline bool cpuHasAvx2() {
+#if defined(OCEAN_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	__cpuid(info, 1);
+	//the processor has AVX and the operating system saves the ymm registers (OSXSAVE)
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#elif defined(OCEAN_X86) && (defined(__GNUC__) || defined(__clang__))
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#else
+	return false;
+#endif
+}
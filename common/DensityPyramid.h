@@ -0,0 +1,226 @@
+// DensityPyramid.h : the numbers of fish and sharks of the ocean at several resolutions, like the mipmaps of a texture
+// level 0 counts tiles of PYRAMID_TILE x PYRAMID_TILE cells and every level above counts tiles twice as large each way, up to a single tile,
+// so a view of any size takes the level that fits it, or a window of a finer level to zoom in
+// the rows are counted by the threads that compute them while they are still in the cache, then build adds them up level by level
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+//side of the tiles of level 0, a row of a tile is counted on a byte
+#define PYRAMID_TILE 16
+
+//the fish and the sharks of a tile
+struct DensityTile {
+	uint32_t fish;
+	uint32_t sharks;
+};
+
+//the tiles of every level cover the whole ocean, row by row
+//a pyramid can count only an area of the ocean, e.g. the block of a process of the hybrid version: the tiles outside of it stay empty
+//and the ones on its edges only hold the cells inside, so the pyramids of all the blocks add up to the pyramid of the ocean
+class DensityPyramid {
+public:
+	//a pyramid of a height x width ocean with the levels from bottom up, counting the whole ocean
+	//only a pyramid from level 0 counts cells, the others are filled from the tiles of another pyramid (see fillAbove)
+	DensityPyramid(int height, int width, int bottom = 0) : h(height), w(width), first(bottom) {
+		int k = first;
+		do {
+			tiles.push_back(std::vector<DensityTile>((size_t)tileRows(k) * tileColumns(k)));
+			k++;
+		} while (tileRows(k - 1) > 1 || tileColumns(k - 1) > 1);
+		if (first == 0) {
+			setArea(1, 1, height, width);
+		}
+	}
+
+	int height() const { return h; }
+	int width() const { return w; }
+	int firstLevel() const { return first; }
+	int lastLevel() const { return first + (int)tiles.size() - 1; }
+	//tile (r, c) of a level holds rows r * tileSize + 1 to (r + 1) * tileSize and the same columns, less on the last row and column of tiles
+	int tileSize(int level) const { return PYRAMID_TILE << level; }
+	int tileRows(int level) const { return (h + tileSize(level) - 1) / tileSize(level); }
+	int tileColumns(int level) const { return (w + tileSize(level) - 1) / tileSize(level); }
+	DensityTile *level(int k) { return &tiles[k - first][0]; }
+	const DensityTile *level(int k) const { return &tiles[k - first][0]; }
+
+	//the finest level at most columns tiles wide
+	int levelFor(int columns) const {
+		int k = first;
+		while (k < lastLevel() && tileColumns(k) > columns) {
+			k++;
+		}
+		return k;
+	}
+
+	//number of cells of tile (r, c) of a level
+	int64_t tileCells(int level, int r, int c) const {
+		int size = tileSize(level);
+		int64_t rows = (r + 1) * (int64_t)size < h ? size : h - r * (int64_t)size;
+		int64_t columns = (c + 1) * (int64_t)size < w ? size : w - c * (int64_t)size;
+		return rows * columns;
+	}
+
+	//counts only the rows firstRow to firstRow + rows - 1 and the same columns of the ocean from now on, all the tiles are emptied
+	void setArea(int firstRow, int firstColumn, int rows, int columns) {
+		areaRow = firstRow;
+		areaColumn = firstColumn;
+		areaRows = rows;
+		areaColumns = columns;
+		firstTile = (firstColumn - 1) / PYRAMID_TILE;
+		stripTiles = (firstColumn + columns - 2) / PYRAMID_TILE - firstTile + 1;
+		fishStrips.assign((size_t)rows * stripTiles, 0);
+		sharkStrips.assign((size_t)rows * stripTiles, 0);
+		for (size_t k = 0; k < tiles.size(); k++) {
+			memset(&tiles[k][0], 0, tiles[k].size() * sizeof(DensityTile));
+		}
+	}
+
+	//counts cells first to last of row i of the area, row[j] being the cell of column j of the area (all 1 based)
+	//called on a row right after the kernel wrote it, the rows are counted on their own so the threads can count different rows at once
+	template <typename Cell>
+	void countCells(int i, const Cell *row, int first, int last) {
+		uint8_t *fish = &fishStrips[(size_t)(i - 1) * stripTiles];
+		uint8_t *sharks = &sharkStrips[(size_t)(i - 1) * stripTiles];
+		int j = first;
+		while (j <= last) {
+			//the cells from j to the last column of its tile
+			int column = areaColumn + j - 2;
+			int tile = column / PYRAMID_TILE;
+			int end = j + (tile + 1) * PYRAMID_TILE - 1 - column;
+			if (end > last) {
+				end = last;
+			}
+			int f = 0;
+			int s = 0;
+			for (; j <= end; j++) {
+				f += row[j] > 0;
+				s += row[j] < 0;
+			}
+			fish[tile - firstTile] += (uint8_t)f;
+			sharks[tile - firstTile] += (uint8_t)s;
+		}
+	}
+
+	//adds fish and sharks to tile (of level 0) of row i of the area, for engines that count a whole tile at once
+	void add(int i, int tile, int fish, int sharks) {
+		fishStrips[(size_t)(i - 1) * stripTiles + tile - firstTile] += (uint8_t)fish;
+		sharkStrips[(size_t)(i - 1) * stripTiles + tile - firstTile] += (uint8_t)sharks;
+	}
+
+	//adds the rows counted since the last time into the tiles of the area on every level, and empties the rows for the next count
+	void build() {
+		int columns = tileColumns(0);
+		int firstRowTile = (areaRow - 1) / PYRAMID_TILE;
+		int lastRowTile = (areaRow + areaRows - 2) / PYRAMID_TILE;
+		for (int r = firstRowTile; r <= lastRowTile; r++) {
+			memset(&tiles[0][(size_t)r * columns + firstTile], 0, stripTiles * sizeof(DensityTile));
+		}
+		for (int i = 0; i < areaRows; i++) {
+			DensityTile *to = &tiles[0][(size_t)((areaRow - 1 + i) / PYRAMID_TILE) * columns + firstTile];
+			const uint8_t *fish = &fishStrips[(size_t)i * stripTiles];
+			const uint8_t *sharks = &sharkStrips[(size_t)i * stripTiles];
+			for (int t = 0; t < stripTiles; t++) {
+				to[t].fish += fish[t];
+				to[t].sharks += sharks[t];
+			}
+		}
+		memset(&fishStrips[0], 0, fishStrips.size());
+		memset(&sharkStrips[0], 0, sharkStrips.size());
+		addUp(0, firstRowTile, lastRowTile, firstTile, firstTile + stripTiles - 1);
+	}
+
+	//fills the levels above level from its tiles, e.g. once the tiles of the blocks of all the processes were added into it
+	void fillAbove(int level) {
+		addUp(level, 0, tileRows(level) - 1, 0, tileColumns(level) - 1);
+	}
+
+	//copies rows x columns tiles of a level starting at tile (firstRow, firstColumn) into out, row by row
+	//the window wraps around the edges of the ocean like the ocean does, so a view can be moved anywhere
+	void window(int level, int firstRow, int firstColumn, int rows, int columns, DensityTile *out) const {
+		int height = tileRows(level);
+		int width = tileColumns(level);
+		const DensityTile *from = this->level(level);
+		for (int r = 0; r < rows; r++) {
+			int row = ((firstRow + r) % height + height) % height;
+			for (int c = 0; c < columns; c++) {
+				int column = ((firstColumn + c) % width + width) % width;
+				*out++ = from[(size_t)row * width + column];
+			}
+		}
+	}
+
+private:
+	//fills the tiles of every level above level that cover tiles firstRow to lastRow and firstColumn to lastColumn of level
+	void addUp(int level, int firstRow, int lastRow, int firstColumn, int lastColumn) {
+		for (int k = level + 1; k <= lastLevel(); k++) {
+			firstRow /= 2;
+			lastRow /= 2;
+			firstColumn /= 2;
+			lastColumn /= 2;
+			const DensityTile *below = this->level(k - 1);
+			int belowRows = tileRows(k - 1);
+			int belowColumns = tileColumns(k - 1);
+			DensityTile *here = this->level(k);
+			int columns = tileColumns(k);
+			for (int r = firstRow; r <= lastRow; r++) {
+				for (int c = firstColumn; c <= lastColumn; c++) {
+					DensityTile sum = { 0, 0 };
+					for (int i = 2 * r; i <= 2 * r + 1 && i < belowRows; i++) {
+						for (int j = 2 * c; j <= 2 * c + 1 && j < belowColumns; j++) {
+							sum.fish += below[(size_t)i * belowColumns + j].fish;
+							sum.sharks += below[(size_t)i * belowColumns + j].sharks;
+						}
+					}
+					here[(size_t)r * columns + c] = sum;
+				}
+			}
+		}
+	}
+
+	int h;
+	int w;
+	int first;
+	std::vector<std::vector<DensityTile> > tiles;
+	//the area counted, and the first tile of level 0 and the number of tiles its columns overlap
+	int areaRow;
+	int areaColumn;
+	int areaRows;
+	int areaColumns;
+	int firstTile;
+	int stripTiles;
+	//the fish and sharks of every row of the area in every tile it overlaps, as counted by countCells
+	std::vector<uint8_t> fishStrips;
+	std::vector<uint8_t> sharkStrips;
+};
+
+//displays a level of a pyramid with a character per tile: - when less than a quarter of its cells are taken,
+//otherwise f or s for the one there are more of, in capitals when at least three quarters of its cells are taken
+inline void printDensity(const DensityPyramid &pyramid, int level) {
+	int rows = pyramid.tileRows(level);
+	int columns = pyramid.tileColumns(level);
+	const DensityTile *tiles = pyramid.level(level);
+	std::string line;
+	for (int r = 0; r < rows; r++) {
+		line.clear();
+		for (int c = 0; c < columns; c++) {
+			const DensityTile &tile = tiles[(size_t)r * columns + c];
+			int64_t cells = pyramid.tileCells(level, r, c);
+			int64_t taken = (int64_t)tile.fish + tile.sharks;
+			char shown = tile.fish >= tile.sharks ? 'f' : 's';
+			if (4 * taken < cells) {
+				shown = '-';
+			}
+			else if (4 * taken >= 3 * cells) {
+				shown = shown == 'f' ? 'F' : 'S';
+			}
+			line += shown;
+		}
+		printf("%s\n", line.c_str());
+	}
+}
@@ -0,0 +1,347 @@
+// FrameChannel.h : hands the latest frames of the simulation to another process through named shared memory
+// the memory holds three frames, a triple buffer: the simulation writes one, one holds the last frame published, and the viewer reads the third
+// publishing a frame and taking the last one are a single atomic exchange each, so the simulation never waits for a slow viewer
+// and the viewer always gets the newest complete frame, the frames it was too slow for are simply replaced
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <atomic>
+#include <new>
+#ifdef _WIN32
+//windows.h defines min and max as macros, which breaks std::min and std::max
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "Ocean.h"
+#include "DensityPyramid.h"
+
+#define FRAME_MAGIC "OCEANFRM"
+#define FRAME_VERSION 1
+
+//the index of the frame that was published last, with FRESH_FRAME set until the viewer takes it
+#define FRAME_INDEX 3
+#define FRESH_FRAME 4
+
+//what a frame holds
+enum FrameContent {
+	CELL_FRAME,    //the cells of the whole ocean, one signed byte per cell row by row like a snapshot
+	DENSITY_FRAME  //the tiles of a level of a density pyramid row by row (see DensityPyramid.h)
+};
+
+//written in front of every frame of a channel
+struct PublishedFrame {
+	int64_t generation;
+	int64_t kind;
+	//size of the ocean, and the level of the tiles of a density frame
+	int64_t height;
+	int64_t width;
+	int64_t level;
+	int64_t bytes;
+};
+
+//the start of the shared memory, followed by the three frames of frameBytes bytes each (header included)
+//the other fields are set once when the memory is created, only state, reader, published and closed change afterwards
+struct ChannelHeader {
+	char magic[8];
+	int64_t version;
+	int64_t frameBytes;
+	//the frame published last (see FRAME_INDEX), exchanged by both sides
+	std::atomic<uint32_t> state;
+	//the frame the viewer holds, only written by the viewer so a new viewer goes on where the last one stopped
+	std::atomic<uint32_t> reader;
+	//number of frames published, and set once the simulation is over
+	std::atomic<uint64_t> published;
+	std::atomic<uint32_t> closed;
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2, "the atomics of a channel are shared between processes so they cannot take a lock");
+
+//named memory that other processes can map, removed when the process that created it closes it
+class SharedMemory {
+public:
+	SharedMemory() : data(NULL), bytes(0), owner(false) {
+#ifdef _WIN32
+		mapping = NULL;
+#endif
+	}
+
+	~SharedMemory() {
+		close();
+	}
+
+	//creates the memory called name with size bytes, all of them zero, returns false when it cannot be created
+	bool create(const char *name, size_t size) {
+		close();
+#ifdef _WIN32
+		mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, name);
+		data = mapping != NULL ? (char *)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size) : NULL;
+#else
+		path = std::string("/") + name;
+		//a memory left by a run that did not close it is replaced
+		shm_unlink(path.c_str());
+		int file = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (file < 0) {
+			return false;
+		}
+		if (ftruncate(file, (off_t)size) == 0) {
+			void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+			data = memory != MAP_FAILED ? (char *)memory : NULL;
+		}
+		::close(file);
+#endif
+		bytes = size;
+		owner = true;
+		if (data == NULL) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	//maps the memory called name created by another process, returns false when there is none
+	bool open(const char *name) {
+		close();
+#ifdef _WIN32
+		mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+		data = mapping != NULL ? (char *)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0) : NULL;
+		MEMORY_BASIC_INFORMATION region;
+		if (data != NULL && VirtualQuery(data, &region, sizeof(region)) != 0) {
+			bytes = region.RegionSize;
+		}
+#else
+		path = std::string("/") + name;
+		int file = shm_open(path.c_str(), O_RDWR, 0600);
+		if (file < 0) {
+			return false;
+		}
+		struct stat status;
+		if (fstat(file, &status) == 0 && status.st_size > 0) {
+			bytes = (size_t)status.st_size;
+			void *memory = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+			data = memory != MAP_FAILED ? (char *)memory : NULL;
+		}
+		::close(file);
+#endif
+		if (data == NULL) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	//unmaps the memory, the process that created it also removes its name, the processes that still map it keep it until they close it
+	void close() {
+#ifdef _WIN32
+		if (data != NULL) {
+			UnmapViewOfFile(data);
+		}
+		if (mapping != NULL) {
+			CloseHandle(mapping);
+		}
+		mapping = NULL;
+#else
+		if (data != NULL) {
+			munmap(data, bytes);
+		}
+		if (owner) {
+			shm_unlink(path.c_str());
+		}
+#endif
+		data = NULL;
+		bytes = 0;
+		owner = false;
+	}
+
+	char *memory() const { return data; }
+	size_t size() const { return bytes; }
+
+private:
+	SharedMemory(const SharedMemory &);
+	SharedMemory &operator=(const SharedMemory &);
+
+#ifdef _WIN32
+	HANDLE mapping;
+#else
+	std::string path;
+#endif
+	char *data;
+	size_t bytes;
+	bool owner;
+};
+
+//the simulation side of a channel, there is a single publisher and a single viewer at a time
+class FramePublisher {
+public:
+	FramePublisher() : channel(NULL), back(0), dropped(0) {}
+
+	~FramePublisher() {
+		close();
+	}
+
+	//creates the channel called name for frames of up to capacity bytes, returns false when it cannot be created
+	bool open(const char *name, size_t capacity) {
+		size_t frameBytes = (sizeof(PublishedFrame) + capacity + 63) / 64 * 64;
+		if (!memory.create(name, sizeof(ChannelHeader) + 3 * frameBytes)) {
+			return false;
+		}
+		channel = new (memory.memory()) ChannelHeader;
+		channel->version = FRAME_VERSION;
+		channel->frameBytes = (int64_t)frameBytes;
+		//the simulation starts with frame 0, frame 1 is the empty one published last and the viewer holds frame 2
+		channel->state.store(1);
+		channel->reader.store(2);
+		channel->published.store(0);
+		channel->closed.store(0);
+		back = 0;
+		//the magic goes last, a viewer does not take the memory before it is set up
+		std::atomic_thread_fence(std::memory_order_release);
+		memcpy(channel->magic, FRAME_MAGIC, sizeof(channel->magic));
+		return true;
+	}
+
+	bool isOpen() const { return channel != NULL; }
+	//the most a frame can hold
+	size_t capacity() const { return (size_t)channel->frameBytes - sizeof(PublishedFrame); }
+	//number of frames replaced by a newer one before the viewer took them
+	uint64_t droppedFrames() const { return dropped; }
+
+	//where the next frame is written, it is only published by publish
+	PublishedFrame *frame() { return (PublishedFrame *)(memory.memory() + sizeof(ChannelHeader) + (size_t)back * (size_t)channel->frameBytes); }
+	uint8_t *frameData() { return (uint8_t *)(frame() + 1); }
+
+	//makes the frame written at frame() the last one published, the viewer gets it the next time it looks
+	//and the simulation goes on with the frame that was published before, or the one the viewer just gave back
+	void publish() {
+		uint32_t previous = channel->state.exchange(back | FRESH_FRAME, std::memory_order_acq_rel);
+		if ((previous & FRESH_FRAME) != 0) {
+			dropped++;
+		}
+		back = previous & FRAME_INDEX;
+		channel->published.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	//publishes the current generation of an ocean, its cells row by row, returns false when they do not fit
+	template <typename Cell>
+	bool publishCells(const Ocean<Cell> &ocean, int64_t generation) {
+		size_t bytes = (size_t)ocean.height() * ocean.width();
+		if (bytes > capacity()) {
+			return false;
+		}
+		PublishedFrame *header = frame();
+		header->generation = generation;
+		header->kind = CELL_FRAME;
+		header->height = ocean.height();
+		header->width = ocean.width();
+		header->level = 0;
+		header->bytes = (int64_t)bytes;
+		int8_t *to = (int8_t *)frameData();
+		for (int i = 1; i <= ocean.height(); i++) {
+			const Cell *row = ocean.oldRow(i);
+			for (int j = 1; j <= ocean.width(); j++) {
+				*to++ = (int8_t)row[j];
+			}
+		}
+		publish();
+		return true;
+	}
+
+	//publishes a level of a density pyramid, returns false when it does not fit
+	bool publishDensity(const DensityPyramid &density, int level, int64_t generation) {
+		size_t bytes = (size_t)density.tileRows(level) * density.tileColumns(level) * sizeof(DensityTile);
+		if (bytes > capacity()) {
+			return false;
+		}
+		PublishedFrame *header = frame();
+		header->generation = generation;
+		header->kind = DENSITY_FRAME;
+		header->height = density.height();
+		header->width = density.width();
+		header->level = level;
+		header->bytes = (int64_t)bytes;
+		memcpy(frameData(), density.level(level), bytes);
+		publish();
+		return true;
+	}
+
+	//tells the viewer that no frame will come after the last one, and removes the name of the channel
+	void close() {
+		if (channel != NULL) {
+			channel->closed.store(1, std::memory_order_release);
+		}
+		channel = NULL;
+		memory.close();
+	}
+
+private:
+	SharedMemory memory;
+	ChannelHeader *channel;
+	//the frame the simulation writes
+	uint32_t back;
+	uint64_t dropped;
+};
+
+//the viewer side of a channel, see FramePublisher
+class FrameViewer {
+public:
+	FrameViewer() : channel(NULL) {}
+
+	//maps the channel called name, returns false when it does not exist yet or is not a channel
+	bool open(const char *name) {
+		channel = NULL;
+		if (!memory.open(name) || memory.size() < sizeof(ChannelHeader)) {
+			return false;
+		}
+		ChannelHeader *header = (ChannelHeader *)memory.memory();
+		if (memcmp(header->magic, FRAME_MAGIC, sizeof(header->magic)) != 0) {
+			memory.close();
+			return false;
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (header->version != FRAME_VERSION || memory.size() < sizeof(ChannelHeader) + 3 * (size_t)header->frameBytes) {
+			memory.close();
+			return false;
+		}
+		channel = header;
+		return true;
+	}
+
+	bool isOpen() const { return channel != NULL; }
+
+	//takes the frame published last if the viewer does not have it yet, returns false when nothing was published since
+	//the frame stays the same until the next call that returns true, whatever the simulation does meanwhile
+	bool update() {
+		if ((channel->state.load(std::memory_order_acquire) & FRESH_FRAME) == 0) {
+			return false;
+		}
+		uint32_t previous = channel->state.exchange(channel->reader.load(std::memory_order_relaxed), std::memory_order_acq_rel);
+		channel->reader.store(previous & FRAME_INDEX, std::memory_order_relaxed);
+		return true;
+	}
+
+	//the frame the viewer holds, its header is all zero before the first one
+	const PublishedFrame *frame() const { return (const PublishedFrame *)(memory.memory() + sizeof(ChannelHeader) + (size_t)channel->reader.load(std::memory_order_relaxed) * (size_t)channel->frameBytes); }
+	const uint8_t *frameData() const { return (const uint8_t *)(frame() + 1); }
+
+	//number of frames the simulation published so far
+	uint64_t published() const { return channel->published.load(std::memory_order_relaxed); }
+	//true once the simulation is over, the frame published last can still be taken
+	bool closed() const { return channel->closed.load(std::memory_order_acquire) != 0; }
+
+private:
+	SharedMemory memory;
+	ChannelHeader *channel;
+};
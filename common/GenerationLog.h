@@ -0,0 +1,474 @@
+// GenerationLog.h : records every generation of a run into a log that any generation can be rebuilt from
+// the log holds a keyframe, the whole ocean, every few generations and in between only the cells that changed occupant:
+// a fish or a shark that lives on is always one generation older (see Kernel.h), so its age is not written,
+// only the deaths and the births are, with one bit telling a newborn shark from a newborn fish
+// an index of the keyframes goes along with the log, so a generation is rebuilt from the keyframe before it
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Ocean.h"
+#include "Snapshot.h"
+#include "Bitboard.h"
+
+//first bytes of a log and of its index
+#define LOG_MAGIC "OCEANLOG"
+#define LOG_INDEX_MAGIC "OCEANIDX"
+//changes whenever the layout of the files changes
+#define LOG_VERSION 1
+
+//number of copies of the ocean that can wait for the writer thread, the simulation only waits when they are all waiting
+#define RECORD_BUFFERS 4
+
+//the header of a log, followed by the frames
+//a state is the ocean before a generation is computed: state n + 1 is the ocean generation n computed
+struct LogHeader {
+	char magic[8];
+	int64_t version;
+	int64_t height;
+	int64_t width;
+	int64_t seed;
+	//a keyframe is written for every state that is a multiple of this
+	int64_t keyframeInterval;
+};
+
+enum FrameKind {
+	//height*width cells row by row, one signed byte per cell
+	KEYFRAME,
+	//the number of changed cells, then one unsigned LEB128 number per changed cell in the order of the cells:
+	//the number of unchanged cells since the previous change times 2, plus 1 for a newborn shark
+	DELTA
+};
+
+//the header of every frame, followed by bytes bytes
+struct FrameHeader {
+	int64_t state;
+	int64_t kind;
+	int64_t bytes;
+};
+
+//the index holds LOG_INDEX_MAGIC then one entry per keyframe
+struct LogIndexEntry {
+	int64_t state;
+	//offset of the FrameHeader of the keyframe in the log
+	int64_t offset;
+};
+
+//moves file to offset, which can be beyond 2GB
+inline bool seekFile(FILE *file, int64_t offset) {
+#ifdef _MSC_VER
+	return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+	return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+//number of cells compared at once by encodeDelta
+#define DELTA_CHUNK 4096
+
+//the cell one generation later when it keeps its occupant: a fish or a shark one generation older, or still empty
+inline int8_t agedCell(int8_t cell) {
+	return (int8_t)(cell + (cell > 0) - (cell < 0));
+}
+
+//appends the delta from the cells before to the cells after to out
+//returns false when a cell did not change the way the rules allow, it then needs a keyframe
+inline bool encodeDelta(const int8_t *before, const int8_t *after, size_t cells, std::vector<uint8_t> &out) {
+	//at most 10 bytes per change, 2 per cell are enough while the changes are close together, the rest is checked below
+	out.resize(sizeof(int64_t) + 2 * cells + 10);
+	uint8_t *p = &out[0] + sizeof(int64_t);
+	int64_t changes = 0;
+	size_t last = (size_t)-1;
+	//the cells that did not simply get older are marked first, in a loop without branches the compiler vectorizes,
+	//then only the marked ones are looked at, 8 marks at a time
+	uint8_t changed[DELTA_CHUNK];
+	for (size_t chunk = 0; chunk < cells; chunk += DELTA_CHUNK) {
+		int count = (int)(cells - chunk < DELTA_CHUNK ? cells - chunk : DELTA_CHUNK);
+		const int8_t *b = before + chunk;
+		const int8_t *a = after + chunk;
+		for (int k = 0; k < count; k++) {
+			changed[k] = (uint8_t)(a[k] != agedCell(b[k]));
+		}
+		for (int k = 0; k < count; k += 8) {
+			uint64_t marks = 0;
+			memcpy(&marks, changed + k, count - k < 8 ? count - k : 8);
+			//the marks are 0 or 1, so the multiplication gathers the 8 of them in the top byte, lowest cell first
+			for (unsigned bits = (unsigned)((marks * 0x0102040810204080ULL) >> 56); bits != 0; bits &= bits - 1) {
+				int l = k + lowestBit(bits);
+				//a death leaves an empty cell, a birth gives a fish or a shark of age 1
+				bool death = b[l] != 0 && a[l] == 0;
+				bool birth = b[l] == 0 && (a[l] == 1 || a[l] == -1);
+				if (!death && !birth) {
+					return false;
+				}
+				size_t cell = chunk + l;
+				uint64_t value = ((uint64_t)(cell - last - 1) << 1) | (a[l] < 0 ? 1 : 0);
+				if ((size_t)(p - &out[0]) + 10 > out.size()) {
+					size_t used = p - &out[0];
+					out.resize(out.size() * 2);
+					p = &out[0] + used;
+				}
+				while (value >= 0x80) {
+					*p++ = (uint8_t)(value | 0x80);
+					value >>= 7;
+				}
+				*p++ = (uint8_t)value;
+				last = cell;
+				changes++;
+			}
+		}
+	}
+	out.resize(p - &out[0]);
+	memcpy(&out[0], &changes, sizeof(changes));
+	return true;
+}
+
+//applies a delta made by encodeDelta to cells, returns false when the delta does not fit the cells
+inline bool applyDelta(const uint8_t *delta, size_t bytes, int8_t *cells, size_t count) {
+	if (bytes < sizeof(int64_t)) {
+		return false;
+	}
+	int64_t changes;
+	memcpy(&changes, delta, sizeof(changes));
+	//every fish and shark gets older, then the ones that died are removed and the newborns added
+	for (size_t k = 0; k < count; k++) {
+		cells[k] = agedCell(cells[k]);
+	}
+	const uint8_t *p = delta + sizeof(int64_t);
+	const uint8_t *end = delta + bytes;
+	size_t k = (size_t)-1;
+	for (int64_t c = 0; c < changes; c++) {
+		uint64_t value = 0;
+		int shift = 0;
+		do {
+			if (p == end || shift > 63) {
+				return false;
+			}
+			value |= (uint64_t)(*p & 0x7F) << shift;
+			shift += 7;
+		} while (*p++ & 0x80);
+		k += (size_t)(value >> 1) + 1;
+		if (k >= count) {
+			return false;
+		}
+		cells[k] = cells[k] != 0 ? 0 : (value & 1) ? -1 : 1;
+	}
+	return p == end;
+}
+
+//writes the states of a run to a log and its index
+//record copies the cells and returns right away, the writer thread compares them with the previous state and writes the frame,
+//so the simulation only waits when RECORD_BUFFERS copies are already waiting
+class GenerationRecorder {
+public:
+	GenerationRecorder() : file(NULL), index(NULL), closing(false), failed(false), keyframes(0), deltas(0), offset(0) {}
+
+	~GenerationRecorder() {
+		close();
+	}
+
+	//creates the log at path and its index at path.idx, and starts the writer thread
+	//returns false when the files cannot be created
+	bool open(const char *path, int height, int width, uint32_t seed, int keyframeInterval) {
+		file = fopen(path, "wb");
+		if (file == NULL) {
+			return false;
+		}
+		index = fopen((std::string(path) + ".idx").c_str(), "wb");
+		if (index == NULL) {
+			fclose(file);
+			file = NULL;
+			return false;
+		}
+		header.height = height;
+		header.width = width;
+		memcpy(header.magic, LOG_MAGIC, 8);
+		header.version = LOG_VERSION;
+		header.seed = seed;
+		header.keyframeInterval = keyframeInterval > 0 ? keyframeInterval : 1;
+		write(&header, sizeof(header));
+		failed = failed || fwrite(LOG_INDEX_MAGIC, 1, 8, index) != 8;
+		for (int b = 0; b < RECORD_BUFFERS; b++) {
+			spares.push_back(std::vector<int8_t>());
+		}
+		closing = false;
+		writer = std::thread(&GenerationRecorder::run, this);
+		return true;
+	}
+
+	bool isOpen() const { return file != NULL; }
+
+	//copies the current map of ocean as state
+	template <typename Cell>
+	void record(const Ocean<Cell> &ocean, int state) {
+		Frame frame;
+		frame.state = state;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while (spares.empty()) {
+				freed.wait(lock);
+			}
+			frame.cells.swap(spares.back());
+			spares.pop_back();
+		}
+		frame.cells.resize((size_t)ocean.height() * ocean.width());
+		packCells(ocean, &frame.cells[0]);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.push_back(Frame());
+			queue.back().state = frame.state;
+			queue.back().cells.swap(frame.cells);
+		}
+		ready.notify_one();
+	}
+
+	//writes the states still waiting, stops the writer thread and closes the files
+	//returns false when something could not be written
+	bool close() {
+		if (file == NULL) {
+			return true;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			closing = true;
+		}
+		ready.notify_one();
+		writer.join();
+		failed = failed | (fclose(file) != 0) | (fclose(index) != 0);
+		file = NULL;
+		index = NULL;
+		return !failed;
+	}
+
+	int keyframeCount() const { return keyframes; }
+	int deltaCount() const { return deltas; }
+	//size of the log
+	int64_t bytes() const { return offset; }
+
+private:
+	//the writer thread keeps a pointer to this, so the recorder cannot be copied
+	GenerationRecorder(const GenerationRecorder &);
+	GenerationRecorder &operator=(const GenerationRecorder &);
+
+	struct Frame {
+		int64_t state;
+		std::vector<int8_t> cells;
+	};
+
+	void write(const void *data, size_t size) {
+		failed = failed || fwrite(data, 1, size, file) != size;
+		offset += size;
+	}
+
+	void writeFrame(const Frame &frame) {
+		FrameHeader frameHeader;
+		frameHeader.state = frame.state;
+		size_t cells = frame.cells.size();
+		//a delta needs the state right before, and is only kept when it is smaller than the keyframe
+		bool delta = !previous.empty() && frame.state == previousState + 1 && frame.state % header.keyframeInterval != 0
+			&& encodeDelta(&previous[0], &frame.cells[0], cells, encoded) && encoded.size() < cells;
+		if (delta) {
+			frameHeader.kind = DELTA;
+			frameHeader.bytes = (int64_t)encoded.size();
+			write(&frameHeader, sizeof(frameHeader));
+			write(&encoded[0], encoded.size());
+			deltas++;
+			return;
+		}
+		LogIndexEntry entry;
+		entry.state = frame.state;
+		entry.offset = offset;
+		failed = failed || fwrite(&entry, sizeof(entry), 1, index) != 1;
+		frameHeader.kind = KEYFRAME;
+		frameHeader.bytes = (int64_t)cells;
+		write(&frameHeader, sizeof(frameHeader));
+		write(&frame.cells[0], cells);
+		keyframes++;
+	}
+
+	void run() {
+		for (;;) {
+			Frame frame;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				while (queue.empty() && !closing) {
+					ready.wait(lock);
+				}
+				if (queue.empty()) {
+					return;
+				}
+				frame.state = queue.front().state;
+				frame.cells.swap(queue.front().cells);
+				queue.pop_front();
+			}
+			writeFrame(frame);
+			//this state is the one the next delta starts from, the one before goes back to the free copies
+			previous.swap(frame.cells);
+			previousState = frame.state;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				spares.push_back(std::vector<int8_t>());
+				spares.back().swap(frame.cells);
+			}
+			freed.notify_one();
+		}
+	}
+
+	FILE *file;
+	FILE *index;
+	LogHeader header;
+	std::deque<Frame> queue;
+	//the copies that are not waiting to be written
+	std::vector<std::vector<int8_t> > spares;
+	bool closing;
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::condition_variable freed;
+	std::thread writer;
+	//only used by the writer thread
+	std::vector<int8_t> previous;
+	int64_t previousState;
+	std::vector<uint8_t> encoded;
+	bool failed;
+	int keyframes;
+	int deltas;
+	int64_t offset;
+};
+
+//reads a log written by GenerationRecorder and rebuilds any state of it
+class GenerationLog {
+public:
+	GenerationLog() : file(NULL), current(-1), position(0) {}
+
+	~GenerationLog() {
+		close();
+	}
+
+	//opens the log at path and reads its index from path.idx
+	//returns false when path is not a log of this version or when its index cannot be read
+	bool open(const char *path) {
+		file = fopen(path, "rb");
+		if (file == NULL) {
+			return false;
+		}
+		if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, LOG_MAGIC, 8) != 0 || header.version != LOG_VERSION
+			|| header.height <= 0 || header.width <= 0) {
+			close();
+			return false;
+		}
+		FILE *indexFile = fopen((std::string(path) + ".idx").c_str(), "rb");
+		char magic[8];
+		if (indexFile == NULL || fread(magic, 1, 8, indexFile) != 8 || memcmp(magic, LOG_INDEX_MAGIC, 8) != 0) {
+			if (indexFile != NULL) {
+				fclose(indexFile);
+			}
+			close();
+			return false;
+		}
+		LogIndexEntry entry;
+		while (fread(&entry, sizeof(entry), 1, indexFile) == 1) {
+			entries.push_back(entry);
+		}
+		fclose(indexFile);
+		if (entries.empty()) {
+			close();
+			return false;
+		}
+		cells.resize((size_t)(header.height * header.width));
+		return true;
+	}
+
+	void close() {
+		if (file != NULL) {
+			fclose(file);
+		}
+		file = NULL;
+		entries.clear();
+		current = -1;
+	}
+
+	int height() const { return (int)header.height; }
+	int width() const { return (int)header.width; }
+	uint32_t seed() const { return (uint32_t)header.seed; }
+	//the first state of the log
+	int64_t firstState() const { return entries[0].state; }
+	//the state rebuilt by the last call to rebuild
+	int64_t state() const { return current; }
+
+	//rebuilds state from the keyframe before it and the deltas after that keyframe
+	//going forward from the state rebuilt last only reads the deltas in between
+	//returns false when the log does not hold that state
+	bool rebuild(int64_t target) {
+		size_t k = entries.size();
+		while (k > 0 && entries[k - 1].state > target) {
+			k--;
+		}
+		if (k == 0) {
+			return false;
+		}
+		const LogIndexEntry &keyframe = entries[k - 1];
+		if (current < keyframe.state || current > target) {
+			current = -1;
+			position = keyframe.offset;
+		}
+		if (!seekFile(file, position)) {
+			return false;
+		}
+		while (current != target) {
+			FrameHeader frame;
+			if (fread(&frame, sizeof(frame), 1, file) != 1 || frame.bytes < 0 || frame.state > target) {
+				current = -1;
+				return false;
+			}
+			bool ok;
+			if (frame.kind == KEYFRAME) {
+				ok = frame.bytes == (int64_t)cells.size() && fread(&cells[0], 1, cells.size(), file) == cells.size();
+			}
+			else {
+				//a delta only follows the state right before it
+				delta.resize((size_t)frame.bytes);
+				ok = frame.kind == DELTA && frame.state == current + 1 && current >= 0
+					&& fread(delta.data(), 1, delta.size(), file) == delta.size()
+					&& applyDelta(delta.data(), delta.size(), &cells[0], cells.size());
+			}
+			if (!ok) {
+				current = -1;
+				return false;
+			}
+			current = frame.state;
+			position += sizeof(frame) + frame.bytes;
+		}
+		return true;
+	}
+
+	//the cells of the state rebuilt last, row by row
+	const int8_t *stateCells() const { return &cells[0]; }
+
+	//copies the state rebuilt last into the current map of ocean, which has to be the size of the log
+	//returns false when a cell is not a fish, a shark or empty
+	template <typename Cell>
+	bool load(Ocean<Cell> &ocean) const {
+		return unpackCells(&cells[0], ocean);
+	}
+
+private:
+	GenerationLog(const GenerationLog &);
+	GenerationLog &operator=(const GenerationLog &);
+
+	FILE *file;
+	LogHeader header;
+	std::vector<LogIndexEntry> entries;
+	std::vector<int8_t> cells;
+	std::vector<uint8_t> delta;
+	int64_t current;
+	//offset of the frame after the state rebuilt last
+	int64_t position;
+};
@@ -0,0 +1,311 @@
+// Kernel.h : the fish and shark rules applied to one row segment of the ocean
+// a scalar version and an AVX2 version that updates a whole vector of cells at once,
+// the AVX2 one is picked at runtime when the processor supports it
+// both also count the births, deaths and population of the cells they update (see Stats.h)
+// and both are templates on the rules (see Rules.h), selectRowKernel picks the kernel of a rule set by its name
+
+#pragma once
+
+#include <stdint.h>
+#include "Ocean.h"
+#include "Cpu.h"
+#include "Random.h"
+#include "Stats.h"
+#include "Rules.h"
+#include "RuleTable.h"
+
+//updates the cells first..last of a row, reading the row and the rows above and below it from the current map
+//and writing the next generation into out, random holds the random numbers of this row in this generation
+//what happened to those cells is added to stats
+template <typename Cell>
+struct RowKernel {
+	typedef void(*Function)(const Cell *above, const Cell *here, const Cell *below, Cell *out, int first, int last, const RowRandom &random, OceanStats &stats);
+};
+
+//a shark dies randomly when its 32 bit random number is below the threshold of the rules,
+//that is 3.1% of 2^32 with the standard rules
+template <typename Rules>
+inline bool sharkHeartAttack(uint32_t random) {
+	return random < Rules::heartAttackThreshold();
+}
+
+//the starting ocean has 25% empty cells, 25% sharks and 50% fish, newborns have an age of 1
+template <typename Cell>
+inline Cell initialCell(uint32_t seed, int i, int j) {
+	uint32_t random = cellRandom(seed, INITIAL_GENERATION, i, j);
+	if (random < 0x40000000u) {
+		return 0;
+	}
+	if (random < 0x80000000u) {
+		return -1;
+	}
+	return 1;
+}
+
+//applies the rules to the single cell here[j] and returns its next value, what happened to it is counted in causes
+//the outcome is looked up in the rule table (see RuleTable.h), only the heart attacks are applied afterwards
+template <typename Cell, typename Rules>
+inline Cell updateCell(const Cell *above, const Cell *here, const Cell *below, int j, const RowRandom &random, int64_t *causes) {
+	//the packed counts of the neighbors, nFish, nAdultFish, nSharks and nAdultSharks
+	//1  2  3
+	//4  X  5
+	//6  7  8
+	const uint16_t *code = NeighborTable<Rules>::code + SHARK_AGES;
+	unsigned counts = code[above[j - 1]] + code[here[j - 1]] + code[below[j - 1]] //neighbors 1, 4, 6
+		+ code[above[j]] + code[below[j]]                                           //neighbors 2, 7
+		+ code[above[j + 1]] + code[here[j + 1]] + code[below[j + 1]];               //neighbors 3, 5, 8
+
+	int value = here[j];
+	int outcome = RuleTable<Rules>::outcome[neighborhood<Rules>(counts) * CELL_VALUES + value + SHARK_AGES];
+	int next = (int8_t)(outcome & 0xFF);
+	int cause = outcome >> 8;
+	//a shark that did not starve can still die randomly, before dying of old age
+	//the random number is drawn for every cell so this is a select and not a branch
+	bool heartAttack = (value < 0) & (cause != CAUSE_STARVED) & sharkHeartAttack<Rules>(random.at(j));
+	next = heartAttack ? 0 : next;
+	cause = heartAttack ? (int)CAUSE_HEART_ATTACK : cause;
+	causes[cause]++;
+	return (Cell)next;
+}
+
+template <typename Cell, typename Rules>
+void updateRowScalar(const Cell *above, const Cell *here, const Cell *below, Cell *out, int first, int last, const RowRandom &random, OceanStats &stats) {
+	//counted locally first, so the counters can stay in registers
+	int64_t causes[CAUSES] = { 0 };
+	OceanStats row;
+	row.clear();
+	for (int j = first; j <= last; j++) {
+		int next = out[j] = updateCell<Cell, Rules>(above, here, below, j, random, causes);
+		row.fish += next > 0;
+		row.sharks += next < 0;
+		row.fishAges += next > 0 ? next : 0;
+		row.sharkAges += next < 0 ? -next : 0;
+	}
+	row.eaten = causes[CAUSE_EATEN];
+	row.overcrowded = causes[CAUSE_OVERCROWDED];
+	row.fishOldAge = causes[CAUSE_FISH_OLD_AGE];
+	row.starved = causes[CAUSE_STARVED];
+	row.heartAttacks = causes[CAUSE_HEART_ATTACK];
+	row.sharkOldAge = causes[CAUSE_SHARK_OLD_AGE];
+	row.fishBorn = causes[CAUSE_FISH_BORN];
+	row.sharksBorn = causes[CAUSE_SHARK_BORN];
+	stats.add(row);
+}
+
+#ifdef OCEAN_X86
+
+//the vector operations the AVX2 kernel needs, for each cell type
+template <typename Cell>
+struct Avx2Ops;
+
+template <>
+struct Avx2Ops<int8_t> {
+	enum { lanes = 32 };
+	static AVX2_TARGET __m256i set1(int value) { return _mm256_set1_epi8((char)value); }
+	static AVX2_TARGET __m256i greater(__m256i a, __m256i b) { return _mm256_cmpgt_epi8(a, b); }
+	static AVX2_TARGET __m256i equal(__m256i a, __m256i b) { return _mm256_cmpeq_epi8(a, b); }
+	static AVX2_TARGET __m256i add(__m256i a, __m256i b) { return _mm256_add_epi8(a, b); }
+	static AVX2_TARGET __m256i sub(__m256i a, __m256i b) { return _mm256_sub_epi8(a, b); }
+	//one bit per lane, set when the lane of the mask is set
+	static AVX2_TARGET uint32_t laneBits(__m256i mask) { return (uint32_t)_mm256_movemask_epi8(mask); }
+	//adds the lanes of a vector of non-negative cells into 4 64 bit sums
+	static AVX2_TARGET __m256i sum64(__m256i x) { return _mm256_sad_epu8(x, _mm256_setzero_si256()); }
+	//the opposite of laneBits: lane k is all ones when bit k is set
+	static AVX2_TARGET __m256i fromBits(uint32_t bits) {
+		//byte k of the result gets byte k/8 of bits, then tests bit k%8 of it
+		const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+			2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+		const __m256i select = _mm256_set1_epi64x((long long)0x8040201008040201ull);
+		__m256i bytes = _mm256_shuffle_epi8(_mm256_set1_epi32((int)bits), spread);
+		return _mm256_cmpeq_epi8(_mm256_and_si256(bytes, select), select);
+	}
+	//one bit per lane, set when the shark in column j+lane has a heart attack, that is when its random number is below threshold
+	static AVX2_TARGET uint32_t heartAttackBits(const RowRandom &random, int j, uint32_t threshold) {
+		return randomBelowBitsAvx2(random, j, threshold)
+			| (randomBelowBitsAvx2(random, j + 8, threshold) << 8)
+			| (randomBelowBitsAvx2(random, j + 16, threshold) << 16)
+			| (randomBelowBitsAvx2(random, j + 24, threshold) << 24);
+	}
+};
+
+template <>
+struct Avx2Ops<int> {
+	enum { lanes = 8 };
+	static AVX2_TARGET __m256i set1(int value) { return _mm256_set1_epi32(value); }
+	static AVX2_TARGET __m256i greater(__m256i a, __m256i b) { return _mm256_cmpgt_epi32(a, b); }
+	static AVX2_TARGET __m256i equal(__m256i a, __m256i b) { return _mm256_cmpeq_epi32(a, b); }
+	static AVX2_TARGET __m256i add(__m256i a, __m256i b) { return _mm256_add_epi32(a, b); }
+	static AVX2_TARGET __m256i sub(__m256i a, __m256i b) { return _mm256_sub_epi32(a, b); }
+	static AVX2_TARGET uint32_t laneBits(__m256i mask) { return (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(mask)); }
+	static AVX2_TARGET __m256i sum64(__m256i x) {
+		return _mm256_add_epi64(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(x)), _mm256_cvtepu32_epi64(_mm256_extracti128_si256(x, 1)));
+	}
+	static AVX2_TARGET __m256i fromBits(uint32_t bits) {
+		const __m256i select = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+		return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((int)bits), select), select);
+	}
+	static AVX2_TARGET uint32_t heartAttackBits(const RowRandom &random, int j, uint32_t threshold) {
+		return randomBelowBitsAvx2(random, j, threshold);
+	}
+};
+
+//adds one neighbor to the four counts, comparisons give -1 in every lane that matches so the counts are decremented
+template <typename Cell, typename Rules>
+AVX2_TARGET inline void evaluateVector(__m256i neighbor, __m256i &nFish, __m256i &nAdultFish, __m256i &nSharks, __m256i &nAdultSharks) {
+	typedef Avx2Ops<Cell> V;
+	nFish = V::sub(nFish, V::greater(neighbor, V::set1(0)));
+	nAdultFish = V::sub(nAdultFish, V::greater(neighbor, V::set1(Rules::FISH_ADULT_AGE - 1)));
+	nSharks = V::sub(nSharks, V::greater(V::set1(0), neighbor));
+	nAdultSharks = V::sub(nAdultSharks, V::greater(V::set1(1 - Rules::SHARK_ADULT_AGE), neighbor));
+}
+
+//same rules as updateCell, but every comparison is done on a whole vector of cells and the
+//outcomes are combined with masks and blends instead of branches
+//the statistics are counted from the same masks, one bit per lane
+template <typename Cell, typename Rules>
+AVX2_TARGET void updateRowAvx2(const Cell *above, const Cell *here, const Cell *below, Cell *out, int first, int last, const RowRandom &random, OceanStats &stats) {
+	typedef Avx2Ops<Cell> V;
+	const int lanes = V::lanes;
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = V::set1(1);
+	OceanStats row;
+	row.clear();
+	__m256i fishAges = zero;
+	__m256i sharkAges = zero;
+	int j = first;
+	for (; j + lanes - 1 <= last; j += lanes) {
+		__m256i nFish = zero;
+		__m256i nAdultFish = zero;
+		__m256i nSharks = zero;
+		__m256i nAdultSharks = zero;
+		evaluateVector<Cell, Rules>(_mm256_loadu_si256((const __m256i *)(above + j - 1)), nFish, nAdultFish, nSharks, nAdultSharks);
+		evaluateVector<Cell, Rules>(_mm256_loadu_si256((const __m256i *)(here + j - 1)), nFish, nAdultFish, nSharks, nAdultSharks);
+		evaluateVector<Cell, Rules>(_mm256_loadu_si256((const __m256i *)(below + j - 1)), nFish, nAdultFish, nSharks, nAdultSharks);
+		evaluateVector<Cell, Rules>(_mm256_loadu_si256((const __m256i *)(above + j)), nFish, nAdultFish, nSharks, nAdultSharks);
+		evaluateVector<Cell, Rules>(_mm256_loadu_si256((const __m256i *)(below + j)), nFish, nAdultFish, nSharks, nAdultSharks);
+		evaluateVector<Cell, Rules>(_mm256_loadu_si256((const __m256i *)(above + j + 1)), nFish, nAdultFish, nSharks, nAdultSharks);
+		evaluateVector<Cell, Rules>(_mm256_loadu_si256((const __m256i *)(here + j + 1)), nFish, nAdultFish, nSharks, nAdultSharks);
+		evaluateVector<Cell, Rules>(_mm256_loadu_si256((const __m256i *)(below + j + 1)), nFish, nAdultFish, nSharks, nAdultSharks);
+
+		__m256i value = _mm256_loadu_si256((const __m256i *)(here + j));
+		__m256i isFish = V::greater(value, zero);
+		__m256i isShark = V::greater(zero, value);
+
+		//a fish dies by being eaten, overpopulation, or old age, otherwise it gets older
+		__m256i eaten = V::greater(nSharks, V::set1(Rules::SHARKS_TO_EAT - 1));
+		__m256i overcrowded = V::greater(nFish, V::set1(Rules::FISH_TO_OVERCROWD - 1));
+		__m256i fishOld = V::greater(value, V::set1(Rules::FISH_MAX_AGE - 1));
+		__m256i fishDies = _mm256_or_si256(_mm256_or_si256(eaten, overcrowded), fishOld);
+		__m256i fishNext = _mm256_andnot_si256(fishDies, V::add(value, one));
+
+		//a shark dies by starvation, randomly, or old age, otherwise it gets older
+		__m256i starved = _mm256_and_si256(V::greater(nSharks, V::set1(Rules::SHARKS_TO_STARVE - 1)), V::equal(nFish, zero));
+		__m256i sharkOld = V::greater(V::set1(1 - Rules::SHARK_MAX_AGE), value);
+		__m256i sharkDies = _mm256_or_si256(starved, sharkOld);
+		//the random numbers are only drawn when there is a shark in this vector
+		uint32_t sharkBits = V::laneBits(isShark);
+		uint32_t heartAttackBits = 0;
+		if (sharkBits != 0) {
+			heartAttackBits = V::heartAttackBits(random, j, Rules::heartAttackThreshold());
+			sharkDies = _mm256_or_si256(sharkDies, V::fromBits(heartAttackBits));
+		}
+		__m256i sharkNext = _mm256_andnot_si256(sharkDies, V::sub(value, one));
+
+		//breeding rules for the empty cells, a fish birth takes precedence over a shark birth
+		__m256i fishBorn = _mm256_and_si256(_mm256_and_si256(V::greater(nFish, V::set1(Rules::FISH_TO_BREED - 1)), V::greater(nAdultFish, V::set1(Rules::ADULT_FISH_TO_BREED - 1))),
+			V::greater(V::set1(Rules::FISH_BREED_MAX_SHARKS + 1), nSharks));
+		__m256i sharkBorn = _mm256_and_si256(_mm256_and_si256(V::greater(nSharks, V::set1(Rules::SHARKS_TO_BREED - 1)), V::greater(nAdultSharks, V::set1(Rules::ADULT_SHARKS_TO_BREED - 1))),
+			V::greater(V::set1(Rules::SHARK_BREED_MAX_FISH + 1), nFish));
+		__m256i emptyNext = _mm256_or_si256(_mm256_and_si256(fishBorn, one), _mm256_andnot_si256(fishBorn, sharkBorn));
+
+		//masks are all ones or all zeros per lane, so a byte blend works for every cell type
+		__m256i next = _mm256_blendv_epi8(emptyNext, fishNext, isFish);
+		next = _mm256_blendv_epi8(next, sharkNext, isShark);
+		_mm256_storeu_si256((__m256i *)(out + j), next);
+
+		//the deaths are counted for the first cause that applies, in the same order as updateCell
+		uint32_t fishBits = V::laneBits(isFish);
+		uint32_t eatenBits = V::laneBits(eaten) & fishBits;
+		uint32_t overcrowdedBits = V::laneBits(overcrowded) & fishBits & ~eatenBits;
+		uint32_t starvedBits = V::laneBits(starved) & sharkBits;
+		heartAttackBits &= sharkBits & ~starvedBits;
+		uint32_t emptyBits = V::laneBits(V::equal(value, zero));
+		uint32_t fishBornBits = V::laneBits(fishBorn) & emptyBits;
+		row.eaten += bitCount(eatenBits);
+		row.overcrowded += bitCount(overcrowdedBits);
+		row.fishOldAge += bitCount(V::laneBits(fishOld) & fishBits & ~(eatenBits | overcrowdedBits));
+		row.starved += bitCount(starvedBits);
+		row.heartAttacks += bitCount(heartAttackBits);
+		row.sharkOldAge += bitCount(V::laneBits(sharkOld) & sharkBits & ~(starvedBits | heartAttackBits));
+		row.fishBorn += bitCount(fishBornBits);
+		row.sharksBorn += bitCount(V::laneBits(sharkBorn) & emptyBits & ~fishBornBits);
+		__m256i fishNow = V::greater(next, zero);
+		__m256i sharksNow = V::greater(zero, next);
+		row.fish += bitCount(V::laneBits(fishNow));
+		row.sharks += bitCount(V::laneBits(sharksNow));
+		fishAges = _mm256_add_epi64(fishAges, V::sum64(_mm256_and_si256(next, fishNow)));
+		sharkAges = _mm256_add_epi64(sharkAges, V::sum64(_mm256_and_si256(V::sub(zero, next), sharksNow)));
+	}
+	int64_t sums[4];
+	_mm256_storeu_si256((__m256i *)sums, fishAges);
+	row.fishAges += sums[0] + sums[1] + sums[2] + sums[3];
+	_mm256_storeu_si256((__m256i *)sums, sharkAges);
+	row.sharkAges += sums[0] + sums[1] + sums[2] + sums[3];
+	stats.add(row);
+	//the cells left over at the end of the row
+	updateRowScalar<Cell, Rules>(above, here, below, out, j, last, random, stats);
+}
+
+#endif
+
+//returns the fastest kernel of a rule set this processor supports, or the scalar one when forceScalar is set
+template <typename Cell, typename Rules>
+typename RowKernel<Cell>::Function rowKernelFor(bool forceScalar) {
+#ifdef OCEAN_X86
+	if (!forceScalar && cpuHasAvx2()) {
+		return &updateRowAvx2<Cell, Rules>;
+	}
+#endif
+	return &updateRowScalar<Cell, Rules>;
+}
+
+//finds the kernel of the rule set called name
+template <typename Cell>
+struct RowKernelFinder {
+	const char *name;
+	bool forceScalar;
+	typename RowKernel<Cell>::Function kernel;
+	template <typename Rules>
+	void use() {
+		if (kernel == NULL && strcmp(name, Rules::name()) == 0) {
+			kernel = rowKernelFor<Cell, Rules>(forceScalar);
+		}
+	}
+};
+
+//returns the kernel of the rule set called rules (see Rules.h), or NULL when there is no such rule set
+template <typename Cell>
+typename RowKernel<Cell>::Function selectRowKernel(bool forceScalar, const char *rules) {
+	RowKernelFinder<Cell> finder = { rules, forceScalar, NULL };
+	forEachRules(finder);
+	return finder.kernel;
+}
+
+//tells whether a kernel is one of the scalar ones
+template <typename Cell>
+struct ScalarKernelFinder {
+	typename RowKernel<Cell>::Function kernel;
+	bool scalar;
+	template <typename Rules>
+	void use() {
+		scalar = scalar || kernel == &updateRowScalar<Cell, Rules>;
+	}
+};
+
+//name of the kernel selectRowKernel picked, to be displayed
+template <typename Cell>
+const char *rowKernelName(typename RowKernel<Cell>::Function kernel) {
+	ScalarKernelFinder<Cell> finder = { kernel, false };
+	forEachRules(finder);
+	return finder.scalar ? "scalar" : "AVX2";
+}
@@ -0,0 +1,153 @@
+// Ocean.h : runtime-sized, double-buffered ocean grid
+// shared by the serial, OpenMP and hybrid (OpenMP+MPI) builds.
+
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <new>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+//both buffers start on a cache line and every row is padded to a whole number of cache lines
+#define OCEAN_ALIGNMENT 64
+
+//type used to store a cell: the age of a fish (1 to 10), minus the age of a shark (-1 to -20), or 0 when empty
+//a byte per cell keeps the ocean 4 times smaller than an int per cell, switch back to int to compare
+typedef int8_t cell_t;
+//typedef int cell_t;
+
+//allocates size bytes aligned to OCEAN_ALIGNMENT, throws std::bad_alloc when out of memory
+inline void *oceanAlloc(size_t size) {
+	void *memory = NULL;
+#ifdef _MSC_VER
+	memory = _aligned_malloc(size, OCEAN_ALIGNMENT);
+#else
+	if (posix_memalign(&memory, OCEAN_ALIGNMENT, size) != 0) {
+		memory = NULL;
+	}
+#endif
+	if (memory == NULL) {
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+inline void oceanFree(void *memory) {
+#ifdef _MSC_VER
+	_aligned_free(memory);
+#else
+	free(memory);
+#endif
+}
+
+//holds two generations of the ocean: the current one (oldMap) that is read, and the next one (newMap) that is written
+//every map has 2 extra rows and 2 extra columns to deal with the boundaries, so real cells go from 1 to height and 1 to width
+//instead of copying newMap back into oldMap after every generation the two buffers are swapped
+//a deeper ring of extra cells can be asked for with halo, rows and columns then go from 1-halo to height+halo and width+halo
+template <typename Cell>
+class Ocean {
+public:
+	Ocean(int height, int width, int halo = 1) : h(height), w(width), ring(halo), owned(true) {
+		rowStride = strideFor(w, ring);
+		origin = originFor(rowStride, ring);
+		size_t bytes = mapBytes(h, w, ring);
+		firstMap = (Cell *)oceanAlloc(bytes);
+		oldMap = firstMap;
+		newMap = (Cell *)oceanAlloc(bytes);
+		memset(oldMap, 0, bytes);
+		memset(newMap, 0, bytes);
+	}
+
+	//the two maps one after the other in memory, 2 * mapBytes bytes aligned to OCEAN_ALIGNMENT that stay owned by the caller
+	//used for maps that other processes read too (see the hybrid version)
+	Ocean(int height, int width, int halo, void *memory) : h(height), w(width), ring(halo), owned(false) {
+		rowStride = strideFor(w, ring);
+		origin = originFor(rowStride, ring);
+		size_t bytes = mapBytes(h, w, ring);
+		firstMap = (Cell *)memory;
+		oldMap = firstMap;
+		newMap = (Cell *)((char *)memory + bytes);
+		memset(oldMap, 0, bytes);
+		memset(newMap, 0, bytes);
+	}
+
+	~Ocean() {
+		if (owned) {
+			oceanFree(oldMap);
+			oceanFree(newMap);
+		}
+	}
+
+	//the row length rounded up to a whole number of cache lines
+	static int strideFor(int width, int halo) {
+		int cellsPerLine = OCEAN_ALIGNMENT / (int)sizeof(Cell);
+		return ((width + 2 * halo + cellsPerLine - 1) / cellsPerLine) * cellsPerLine;
+	}
+
+	//offset of the cell (0, 0) from the start of a map, row 0 and column 0 start the maps when the ring is 1 cell deep
+	static size_t originFor(int stride, int halo) {
+		return (size_t)(halo - 1) * stride + halo - 1;
+	}
+
+	//size of one map
+	static size_t mapBytes(int height, int width, int halo) {
+		return (size_t)(height + 2 * halo) * strideFor(width, halo) * sizeof(Cell);
+	}
+
+	int height() const { return h; }
+	int width() const { return w; }
+	//depth of the ring of extra cells
+	int halo() const { return ring; }
+	//number of cells between the start of two consecutive rows
+	int stride() const { return rowStride; }
+
+	//row i (1-halo to height+halo, 0 to height+1 by default) of the current generation
+	Cell *oldRow(int i) { return oldMap + origin + (ptrdiff_t)i * rowStride; }
+	const Cell *oldRow(int i) const { return oldMap + origin + (ptrdiff_t)i * rowStride; }
+	//row i (1-halo to height+halo) of the generation being computed
+	Cell *newRow(int i) { return newMap + origin + (ptrdiff_t)i * rowStride; }
+
+	//0 when the current generation is in the first map, 1 when it is in the second one
+	int current() const { return oldMap == firstMap ? 0 : 1; }
+
+	//makes the generation that was just written into newMap the current one
+	void swap() {
+		Cell *temp = oldMap;
+		oldMap = newMap;
+		newMap = temp;
+	}
+
+	//copies the edges of oldMap into its extra rows and columns to simulate an infinite ocean, only the first ring is filled
+	void wrapBoundaries() {
+		/* left-right boundary conditions */
+		for (int i = 1; i <= h; i++) {
+			Cell *row = oldRow(i);
+			row[0] = row[w];
+			row[w + 1] = row[1];
+		}
+		/* top-bottom boundary conditions, the extra columns are included so the corners are copied too */
+		memcpy(oldRow(0), oldRow(h), (w + 2) * sizeof(Cell));
+		memcpy(oldRow(h + 1), oldRow(1), (w + 2) * sizeof(Cell));
+	}
+
+private:
+	//the buffers are owned, so the ocean cannot be copied
+	Ocean(const Ocean &);
+	Ocean &operator=(const Ocean &);
+
+	int h;
+	int w;
+	int ring;
+	//false when the maps were given to the constructor
+	bool owned;
+	int rowStride;
+	//offset of the cell (0, 0) from the start of a map
+	size_t origin;
+	Cell *firstMap;
+	Cell *oldMap;
+	Cell *newMap;
+};
@@ -0,0 +1,31 @@
+// Options.h : command line options of the form --name=value
+// e.g. PreyPredator.exe --height=512 --width=512 --steps=1000
+
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+
+//returns the text after "--name=" or NULL when the option was not given
+inline const char *optionValue(int argc, char *argv[], const char *name) {
+	size_t length = strlen(name);
+	for (int k = 1; k < argc; k++) {
+		const char *arg = argv[k];
+		if (arg[0] == '-' && arg[1] == '-' && strncmp(arg + 2, name, length) == 0 && arg[2 + length] == '=') {
+			return arg + 3 + length;
+		}
+	}
+	return NULL;
+}
+
+//returns the option as an integer, or defaultValue when it was not given
+inline int intOption(int argc, char *argv[], const char *name, int defaultValue) {
+	const char *value = optionValue(argc, argv, name);
+	return value ? atoi(value) : defaultValue;
+}
+
+//true when the option was given with exactly this value, e.g. optionIs(argc, argv, "kernel", "scalar") for --kernel=scalar
+inline bool optionIs(int argc, char *argv[], const char *name, const char *expected) {
+	const char *value = optionValue(argc, argv, name);
+	return value != NULL && strcmp(value, expected) == 0;
+}
@@ -0,0 +1,90 @@
+// Random.h : stateless, counter-based random numbers
+// every random number is a hash of (seed, generation, row, column), so any thread or process can draw
+// the number of any cell without sharing state, and the result does not depend on how the work is split
+
+#pragma once
+
+#include <stdint.h>
+#include "Cpu.h"
+
+//generation number used to draw the initial ocean, so it never collides with a real generation
+#define INITIAL_GENERATION 0xFFFFFFFFu
+
+//the golden ratio step of SplitMix
+#define GOLDEN_GAMMA 0x9E3779B9u
+
+//murmur3 finalizer, every input bit affects every output bit
+inline uint32_t mix32(uint32_t x) {
+	x ^= x >> 16;
+	x *= 0x85EBCA6Bu;
+	x ^= x >> 13;
+	x *= 0xC2B2AE35u;
+	x ^= x >> 16;
+	return x;
+}
+
+//the random numbers of one row in one generation
+//column j gets mix32(key + j * GOLDEN_GAMMA), which is SplitMix32 started at key
+struct RowRandom {
+	uint32_t key;
+	//added to the local column number to get the column in the whole ocean
+	int columnOffset;
+
+	uint32_t at(int j) const {
+		return mix32(key + (uint32_t)(j + columnOffset) * GOLDEN_GAMMA);
+	}
+};
+
+//row is the row number in the whole ocean, columnOffset turns local column numbers into columns of the whole ocean
+inline RowRandom rowRandom(uint32_t seed, uint32_t generation, int row, int columnOffset) {
+	RowRandom random;
+	random.key = mix32(mix32(mix32(seed + GOLDEN_GAMMA) ^ generation) ^ (uint32_t)row);
+	random.columnOffset = columnOffset;
+	return random;
+}
+
+//random number of a single cell (i, j) of the whole ocean
+inline uint32_t cellRandom(uint32_t seed, uint32_t generation, int i, int j) {
+	return rowRandom(seed, generation, i, 0).at(j);
+}
+
+//writes the random numbers of columns first..first+count-1 into out
+inline void randomBatch(const RowRandom &random, int first, int count, uint32_t *out) {
+	for (int k = 0; k < count; k++) {
+		out[k] = random.at(first + k);
+	}
+}
+
+#ifdef OCEAN_X86
+
+//random numbers of the 8 columns first..first+7, same values as RowRandom::at
+AVX2_TARGET inline __m256i randomVectorAvx2(const RowRandom &random, int first) {
+	__m256i columns = _mm256_add_epi32(_mm256_set1_epi32(first + random.columnOffset), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	__m256i x = _mm256_add_epi32(_mm256_set1_epi32((int)random.key), _mm256_mullo_epi32(columns, _mm256_set1_epi32((int)GOLDEN_GAMMA)));
+	x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+	x = _mm256_mullo_epi32(x, _mm256_set1_epi32((int)0x85EBCA6Bu));
+	x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 13));
+	x = _mm256_mullo_epi32(x, _mm256_set1_epi32((int)0xC2B2AE35u));
+	x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+	return x;
+}
+
+//vectorized randomBatch, count does not need to be a multiple of 8
+AVX2_TARGET inline void randomBatchAvx2(const RowRandom &random, int first, int count, uint32_t *out) {
+	int k = 0;
+	for (; k + 8 <= count; k += 8) {
+		_mm256_storeu_si256((__m256i *)(out + k), randomVectorAvx2(random, first + k));
+	}
+	randomBatch(random, first + k, count - k, out + k);
+}
+
+//one bit per column first..first+7, set when the random number of that column is below threshold
+AVX2_TARGET inline uint32_t randomBelowBitsAvx2(const RowRandom &random, int first, uint32_t threshold) {
+	//there is no unsigned compare, flipping the sign bit of both sides gives the same order with a signed one
+	const __m256i flip = _mm256_set1_epi32((int)0x80000000u);
+	__m256i values = _mm256_xor_si256(randomVectorAvx2(random, first), flip);
+	__m256i below = _mm256_cmpgt_epi32(_mm256_xor_si256(_mm256_set1_epi32((int)threshold), flip), values);
+	return (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(below));
+}
+
+#endif
@@ -0,0 +1,133 @@
+// RuleTable.h : the fish, shark and breeding rules as tables built at compile time
+// a cell's next value and the cause of what happened to it are read from a table indexed by a packed key
+// made of its value and of the few facts about its neighborhood the rules test, instead of a chain of branches
+// there is one set of tables per rule set (see Rules.h)
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <utility>
+#include "Stats.h"
+#include "Rules.h"
+
+//number of different cell values, from -SHARK_AGES to FISH_AGES, the oldest a rule set can let a fish or a shark get
+#define CELL_VALUES (SHARK_AGES + 1 + FISH_AGES)
+
+//what happened to a cell, kept with its next value in the table so the statistics need no branch either
+enum RuleCause {
+	CAUSE_NONE,
+	CAUSE_EATEN,
+	CAUSE_OVERCROWDED,
+	CAUSE_FISH_OLD_AGE,
+	CAUSE_STARVED,
+	CAUSE_HEART_ATTACK,
+	CAUSE_SHARK_OLD_AGE,
+	CAUSE_FISH_BORN,
+	CAUSE_SHARK_BORN,
+	CAUSES
+};
+
+//the facts about the 8 neighbors the rules depend on, one bit each
+enum Neighborhood {
+	HOOD_EATEN = 1,          //enough sharks to eat a fish
+	HOOD_OVERCROWDED = 2,    //enough fish to overcrowd a fish
+	HOOD_STARVING = 4,       //enough sharks to starve a shark, and no fish
+	HOOD_FISH_BIRTH = 8,     //enough fish and adult fish for a fish to be born
+	HOOD_SHARK_BIRTH = 16,   //enough sharks and adult sharks for a shark to be born
+	NEIGHBORHOODS = 32
+};
+
+//number of entries of the rule table
+#define RULE_KEYS (NEIGHBORHOODS * CELL_VALUES)
+
+//a neighbor adds 1 to each 4 bit count it belongs to: fish, adult fish, sharks and adult sharks, from the lowest bits up
+//the 8 neighbors are added together without carrying from one count into the next
+template <typename Rules>
+constexpr uint16_t neighborCode(int value) {
+	return (uint16_t)(value > 0 ? (value >= Rules::FISH_ADULT_AGE ? 0x0011 : 0x0001)
+		: value < 0 ? (-value >= Rules::SHARK_ADULT_AGE ? 0x1100 : 0x0100) : 0);
+}
+
+//the neighborhood bits of the summed codes of the 8 neighbors, the comparisons are combined without branching
+template <typename Rules>
+inline int neighborhood(unsigned counts) {
+	int nFish = counts & 15;
+	int nAdultFish = (counts >> 4) & 15;
+	int nSharks = (counts >> 8) & 15;
+	int nAdultSharks = counts >> 12;
+	return (nSharks >= Rules::SHARKS_TO_EAT) * HOOD_EATEN
+		| (nFish >= Rules::FISH_TO_OVERCROWD) * HOOD_OVERCROWDED
+		| ((nSharks >= Rules::SHARKS_TO_STARVE) & (nFish == 0)) * HOOD_STARVING
+		| ((nFish >= Rules::FISH_TO_BREED) & (nAdultFish >= Rules::ADULT_FISH_TO_BREED) & (nSharks <= Rules::FISH_BREED_MAX_SHARKS)) * HOOD_FISH_BIRTH
+		| ((nSharks >= Rules::SHARKS_TO_BREED) & (nAdultSharks >= Rules::ADULT_SHARKS_TO_BREED) & (nFish <= Rules::SHARK_BREED_MAX_FISH)) * HOOD_SHARK_BIRTH;
+}
+
+//an entry holds the next value in its low byte and the cause in its high byte
+constexpr int16_t ruleEntry(int next, int cause) {
+	return (int16_t)((cause << 8) | (next & 0xFF));
+}
+
+//a fish can die by being eaten, overpopulation, or old age, otherwise it gets older
+template <typename Rules>
+constexpr int16_t fishRule(int value, int hood) {
+	return (hood & HOOD_EATEN) ? ruleEntry(0, CAUSE_EATEN)
+		: (hood & HOOD_OVERCROWDED) ? ruleEntry(0, CAUSE_OVERCROWDED)
+		: value >= Rules::FISH_MAX_AGE ? ruleEntry(0, CAUSE_FISH_OLD_AGE)
+		: ruleEntry(value + 1, CAUSE_NONE);
+}
+
+//a shark can die by starvation or old age, otherwise it gets older
+//the random heart attacks come between the two and are applied after the lookup
+template <typename Rules>
+constexpr int16_t sharkRule(int value, int hood) {
+	return (hood & HOOD_STARVING) ? ruleEntry(0, CAUSE_STARVED)
+		: -value >= Rules::SHARK_MAX_AGE ? ruleEntry(0, CAUSE_SHARK_OLD_AGE)
+		: ruleEntry(value - 1, CAUSE_NONE);
+}
+
+//a fish birth takes precedence over a shark birth
+constexpr int16_t emptyRule(int hood) {
+	return (hood & HOOD_FISH_BIRTH) ? ruleEntry(1, CAUSE_FISH_BORN)
+		: (hood & HOOD_SHARK_BIRTH) ? ruleEntry(-1, CAUSE_SHARK_BORN)
+		: ruleEntry(0, CAUSE_NONE);
+}
+
+//the key is neighborhood * CELL_VALUES + value + SHARK_AGES
+template <typename Rules>
+constexpr int16_t ruleOutcome(size_t key) {
+	return (int)(key % CELL_VALUES) - SHARK_AGES > 0 ? fishRule<Rules>((int)(key % CELL_VALUES) - SHARK_AGES, (int)(key / CELL_VALUES))
+		: (int)(key % CELL_VALUES) - SHARK_AGES < 0 ? sharkRule<Rules>((int)(key % CELL_VALUES) - SHARK_AGES, (int)(key / CELL_VALUES))
+		: emptyRule((int)(key / CELL_VALUES));
+}
+
+//the tables of a rule set, filled by the compiler from the functions above
+template <typename Rules, typename Values>
+struct NeighborTables;
+
+template <typename Rules, size_t... Value>
+struct NeighborTables<Rules, std::index_sequence<Value...> > {
+	//indexed by the value of a neighbor + SHARK_AGES
+	static const uint16_t code[sizeof...(Value)];
+};
+
+template <typename Rules, size_t... Value>
+const uint16_t NeighborTables<Rules, std::index_sequence<Value...> >::code[sizeof...(Value)] = { neighborCode<Rules>((int)Value - SHARK_AGES)... };
+
+template <typename Rules, typename Keys>
+struct RuleTables;
+
+template <typename Rules, size_t... Key>
+struct RuleTables<Rules, std::index_sequence<Key...> > {
+	static_assert(Rules::FISH_MAX_AGE <= FISH_AGES && Rules::SHARK_MAX_AGE <= SHARK_AGES, "the ages of a rule set have to fit in the cells and the histograms");
+	//indexed by the key of ruleOutcome
+	static const int16_t outcome[sizeof...(Key)];
+};
+
+template <typename Rules, size_t... Key>
+const int16_t RuleTables<Rules, std::index_sequence<Key...> >::outcome[sizeof...(Key)] = { ruleOutcome<Rules>(Key)... };
+
+template <typename Rules>
+struct NeighborTable : NeighborTables<Rules, std::make_index_sequence<CELL_VALUES> > {};
+template <typename Rules>
+struct RuleTable : RuleTables<Rules, std::make_index_sequence<RULE_KEYS> > {};
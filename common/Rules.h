@@ -0,0 +1,93 @@
+// Rules.h : the thresholds of the fish and shark rules, as compile-time policies
+// every kernel is a template on one of these structs, so each rule set gets its own kernel with the thresholds
+// folded into the code, and --rules= picks one of the precompiled rule sets at startup
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+//the threshold a 32 bit random number has to be below for an event of probability p
+#define PROBABILITY_THRESHOLD(p) ((uint32_t)((p) * 4294967296.0))
+
+//the rules of the original simulation
+struct StandardRules {
+	enum {
+		//age from which a fish or a shark counts as an adult when it comes to breeding
+		FISH_ADULT_AGE = 2,
+		SHARK_ADULT_AGE = 3,
+		//a fish or a shark of this age dies of old age in the next generation
+		FISH_MAX_AGE = 10,
+		SHARK_MAX_AGE = 20,
+		//a fish is eaten when it has at least this many sharks around it
+		SHARKS_TO_EAT = 5,
+		//a fish dies of overpopulation when it has at least this many fish around it
+		FISH_TO_OVERCROWD = 8,
+		//a shark starves when it has at least this many sharks and no fish around it
+		SHARKS_TO_STARVE = 6,
+		//a fish is born in an empty cell with at least this many fish around it, this many of them adults,
+		//and at most this many sharks
+		FISH_TO_BREED = 4,
+		ADULT_FISH_TO_BREED = 3,
+		FISH_BREED_MAX_SHARKS = 3,
+		//same for a shark, a fish birth takes precedence
+		SHARKS_TO_BREED = 4,
+		ADULT_SHARKS_TO_BREED = 3,
+		SHARK_BREED_MAX_FISH = 3
+	};
+	//a shark has a 3.1% chance of dying randomly every generation
+	static constexpr uint32_t heartAttackThreshold() { return PROBABILITY_THRESHOLD(0.031); }
+	static constexpr const char *name() { return "standard"; }
+};
+
+//shorter lives and more heart attacks, for the sweeps over the life expectancy
+struct ShortLivedRules : StandardRules {
+	enum {
+		FISH_MAX_AGE = 8,
+		SHARK_MAX_AGE = 15
+	};
+	static constexpr uint32_t heartAttackThreshold() { return PROBABILITY_THRESHOLD(0.05); }
+	static constexpr const char *name() { return "shortlived"; }
+};
+
+//the rule sets that can be picked with --rules=, a new rule set only has to be added here
+//calls visitor.use<Rules>() for every one of them
+template <typename Visitor>
+inline void forEachRules(Visitor &visitor) {
+	visitor.template use<StandardRules>();
+	visitor.template use<ShortLivedRules>();
+}
+
+//the rule set used when --rules= is not given
+#define DEFAULT_RULES "standard"
+
+//true when there is a rule set called name
+struct RulesFinder {
+	const char *name;
+	bool found;
+	template <typename Rules>
+	void use() {
+		found = found || strcmp(name, Rules::name()) == 0;
+	}
+};
+
+inline bool knownRules(const char *name) {
+	RulesFinder finder = { name, false };
+	forEachRules(finder);
+	return finder.found;
+}
+
+//displays the names of the rule sets, separated by spaces
+struct RulesPrinter {
+	template <typename Rules>
+	void use() {
+		printf(" %s", Rules::name());
+	}
+};
+
+inline void printRuleNames() {
+	RulesPrinter printer;
+	forEachRules(printer);
+	printf("\n");
+}
@@ -0,0 +1,142 @@
+// Series.h : writes the statistics of every generation to a file, as a time series
+// the records are queued and written by a background thread, so the simulation never waits for the disk
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Stats.h"
+
+//first bytes of a binary series, followed by the number of 64 bit integers in a record
+#define SERIES_MAGIC "OCEANSER"
+
+//one line (CSV) or one record (binary) per generation: the generation number followed by the fields of OceanStats
+//a path ending in .bin gives the binary format, anything else CSV with a header line
+class SeriesWriter {
+public:
+	SeriesWriter() : file(NULL), binary(false), closing(false) {}
+
+	~SeriesWriter() {
+		close();
+	}
+
+	//creates the file and starts the writer thread, returns false when the file cannot be created
+	bool open(const char *path) {
+		size_t length = strlen(path);
+		binary = length >= 4 && strcmp(path + length - 4, ".bin") == 0;
+		file = fopen(path, binary ? "wb" : "w");
+		if (file == NULL) {
+			return false;
+		}
+		writeHeader();
+		closing = false;
+		writer = std::thread(&SeriesWriter::run, this);
+		return true;
+	}
+
+	bool isOpen() const { return file != NULL; }
+
+	//queues the statistics of a generation and returns right away
+	void write(int generation, const OceanStats &stats) {
+		Record record;
+		record.generation = generation;
+		record.stats = stats;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.push_back(record);
+		}
+		ready.notify_one();
+	}
+
+	//writes what is still queued, stops the writer thread and closes the file
+	void close() {
+		if (file == NULL) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			closing = true;
+		}
+		ready.notify_one();
+		writer.join();
+		fclose(file);
+		file = NULL;
+	}
+
+private:
+	//the writer thread keeps a pointer to this, so the writer cannot be copied
+	SeriesWriter(const SeriesWriter &);
+	SeriesWriter &operator=(const SeriesWriter &);
+
+	struct Record {
+		int64_t generation;
+		OceanStats stats;
+	};
+
+	void writeHeader() {
+		if (binary) {
+			int64_t fields = 1 + OCEAN_STATS_FIELDS;
+			fwrite(SERIES_MAGIC, 1, 8, file);
+			fwrite(&fields, sizeof(fields), 1, file);
+			return;
+		}
+		fprintf(file, "generation,fish,sharks,fishAges,sharkAges,fishBorn,sharksBorn,eaten,overcrowded,fishOldAge,starved,heartAttacks,sharkOldAge");
+		for (int a = 1; a <= FISH_AGES; a++) {
+			fprintf(file, ",fish%d", a);
+		}
+		for (int a = 1; a <= SHARK_AGES; a++) {
+			fprintf(file, ",shark%d", a);
+		}
+		fprintf(file, "\n");
+	}
+
+	void writeRecord(const Record &record) {
+		if (binary) {
+			fwrite(&record.generation, sizeof(int64_t), 1, file);
+			fwrite(&record.stats, sizeof(int64_t), OCEAN_STATS_FIELDS, file);
+			return;
+		}
+		const int64_t *fields = (const int64_t *)&record.stats;
+		fprintf(file, "%lld", (long long)record.generation);
+		for (int k = 0; k < OCEAN_STATS_FIELDS; k++) {
+			fprintf(file, ",%lld", (long long)fields[k]);
+		}
+		fprintf(file, "\n");
+	}
+
+	//takes all the queued records at once and writes them outside the lock
+	void run() {
+		std::deque<Record> pending;
+		for (;;) {
+			bool last;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				while (queue.empty() && !closing) {
+					ready.wait(lock);
+				}
+				pending.swap(queue);
+				last = closing;
+			}
+			for (size_t k = 0; k < pending.size(); k++) {
+				writeRecord(pending[k]);
+			}
+			pending.clear();
+			if (last) {
+				return;
+			}
+		}
+	}
+
+	FILE *file;
+	bool binary;
+	bool closing;
+	std::deque<Record> queue;
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::thread writer;
+};
@@ -0,0 +1,424 @@
+// Snapshot.h : binary snapshots of the whole ocean, written through a memory mapped file by a background thread
+// the cells are copied out of the current map right after a swap, so the simulation goes on while the copy is written,
+// and a snapshot is read back by mapping it, e.g. to start a run again from it
+// the background thread can compress the cells first, band by band on several threads (see BandCodec.h)
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#ifdef _WIN32
+//without the min and max macros, which would break std::min and std::max
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "Ocean.h"
+#include "Stats.h"
+#include "BandCodec.h"
+
+//first bytes of a snapshot
+#define SNAPSHOT_MAGIC "OCEANSNP"
+//changes whenever the layout of the file changes
+#define SNAPSHOT_VERSION 2
+
+//how the cells of a snapshot are stored
+enum SnapshotEncoding {
+	//one signed byte per cell row by row, whatever cell_t is
+	RAW_CELLS,
+	//the same cells compressed by BandCodec
+	BAND_CELLS
+};
+
+//the header of a snapshot, followed by the height*width cells stored as encoding says
+//the random numbers depend only on the seed, the generation and the position of a cell, so this is all a run needs to go on
+struct SnapshotHeader {
+	char magic[8];
+	int64_t version;
+	int64_t height;
+	int64_t width;
+	//the next generation to compute
+	int64_t generation;
+	int64_t seed;
+	int64_t encoding;
+};
+
+//copies the cells of the current map of ocean into out, one signed byte per cell row by row, without the extra cells
+template <typename Cell>
+inline void packCells(const Ocean<Cell> &ocean, int8_t *out) {
+	int width = ocean.width();
+	for (int i = 1; i <= ocean.height(); i++) {
+		const Cell *row = ocean.oldRow(i) + 1;
+		int8_t *to = out + (size_t)(i - 1) * width;
+		for (int j = 0; j < width; j++) {
+			to[j] = (int8_t)row[j];
+		}
+	}
+}
+
+//the opposite of packCells, returns false when a cell is not a fish, a shark or empty
+template <typename Cell>
+inline bool unpackCells(const int8_t *cells, Ocean<Cell> &ocean) {
+	int width = ocean.width();
+	for (int i = 1; i <= ocean.height(); i++) {
+		const int8_t *from = cells + (size_t)(i - 1) * width;
+		Cell *row = ocean.oldRow(i) + 1;
+		for (int j = 0; j < width; j++) {
+			if (from[j] < -SHARK_AGES || from[j] > FISH_AGES) {
+				return false;
+			}
+			row[j] = (Cell)from[j];
+		}
+	}
+	return true;
+}
+
+//a whole file mapped in memory, either created with a given size to be written or opened to be read
+class MappedFile {
+public:
+	MappedFile() : data(NULL), bytes(0) {
+#ifdef _WIN32
+		file = INVALID_HANDLE_VALUE;
+		mapping = NULL;
+#else
+		file = -1;
+#endif
+	}
+
+	~MappedFile() {
+		close();
+	}
+
+	//creates path with size bytes and maps it to be written, returns false when it cannot be created
+	bool create(const char *path, size_t size) {
+		close();
+#ifdef _WIN32
+		file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, NULL);
+		data = mapping != NULL ? (char *)MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size) : NULL;
+#else
+		file = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (file < 0) {
+			return false;
+		}
+		if (ftruncate(file, (off_t)size) == 0) {
+			void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+			data = memory != MAP_FAILED ? (char *)memory : NULL;
+		}
+#endif
+		bytes = size;
+		if (data == NULL) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	//maps the whole of path to be read, returns false when it cannot be opened or is empty
+	bool openForReading(const char *path) {
+		close();
+#ifdef _WIN32
+		file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER size;
+		if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+			bytes = (size_t)size.QuadPart;
+			mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+			data = mapping != NULL ? (char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+		}
+#else
+		file = open(path, O_RDONLY);
+		if (file < 0) {
+			return false;
+		}
+		struct stat status;
+		if (fstat(file, &status) == 0 && status.st_size > 0) {
+			bytes = (size_t)status.st_size;
+			void *memory = mmap(NULL, bytes, PROT_READ, MAP_SHARED, file, 0);
+			data = memory != MAP_FAILED ? (char *)memory : NULL;
+		}
+#endif
+		if (data == NULL) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	//writes what was changed to the disk and unmaps the file, returns false when the writing failed
+	bool close() {
+		bool ok = true;
+#ifdef _WIN32
+		if (data != NULL) {
+			ok = FlushViewOfFile(data, 0) != 0;
+			UnmapViewOfFile(data);
+		}
+		if (mapping != NULL) {
+			CloseHandle(mapping);
+		}
+		if (file != INVALID_HANDLE_VALUE) {
+			CloseHandle(file);
+		}
+		mapping = NULL;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (data != NULL) {
+			ok = msync(data, bytes, MS_SYNC) == 0;
+			munmap(data, bytes);
+		}
+		if (file >= 0) {
+			::close(file);
+		}
+		file = -1;
+#endif
+		data = NULL;
+		bytes = 0;
+		return ok;
+	}
+
+	char *memory() const { return data; }
+	size_t size() const { return bytes; }
+
+private:
+	MappedFile(const MappedFile &);
+	MappedFile &operator=(const MappedFile &);
+
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int file;
+#endif
+	char *data;
+	size_t bytes;
+};
+
+//replaces path by from, rename does not replace an existing file on Windows
+inline bool replaceFile(const char *from, const char *path) {
+#ifdef _WIN32
+	return MoveFileExA(from, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(from, path) == 0;
+#endif
+}
+
+//writes snapshots of the ocean to a file, each one replacing the previous one
+//capture copies the cells and returns right away, the writer thread maps the file and writes the copy
+//when a snapshot is taken before the previous one was written, the one still waiting is dropped and only the newest is written,
+//so the simulation never waits for the disk and at most three copies of the cells are kept
+//with compression the writer thread compresses the copy before writing it, and keeps the raw cells when that is not smaller
+class SnapshotWriter {
+public:
+	SnapshotWriter() : started(false), codec(NULL), waiting(false), closing(false), dropped(0), failed(0), cellBytes(0), writtenBytes(0) {}
+
+	~SnapshotWriter() {
+		close();
+	}
+
+	//starts the writer thread, the snapshots go to path, written as path.part first and renamed once complete
+	//compressThreads threads compress every snapshot, 0 writes the raw cells
+	void start(const char *snapshotPath, int compressThreads = 0) {
+		path = snapshotPath;
+		part = path + ".part";
+		closing = false;
+		started = true;
+		if (compressThreads > 0) {
+			codec = new BandCodec(compressThreads);
+		}
+		writer = std::thread(&SnapshotWriter::run, this);
+	}
+
+	bool isOpen() const { return started; }
+
+	//copies the current map of ocean, generation is the next generation to compute
+	template <typename Cell>
+	void capture(const Ocean<Cell> &ocean, int generation, uint32_t seed) {
+		int height = ocean.height();
+		int width = ocean.width();
+		//the copy is made into the spare buffer, which only this thread uses
+		spare.resize(sizeof(SnapshotHeader) + (size_t)height * width);
+		SnapshotHeader header;
+		memcpy(header.magic, SNAPSHOT_MAGIC, 8);
+		header.version = SNAPSHOT_VERSION;
+		header.height = height;
+		header.width = width;
+		header.generation = generation;
+		header.seed = seed;
+		header.encoding = RAW_CELLS;
+		memcpy(&spare[0], &header, sizeof(header));
+		packCells(ocean, (int8_t *)&spare[sizeof(header)]);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (waiting) {
+				dropped++;
+			}
+			pending.swap(spare);
+			waiting = true;
+		}
+		ready.notify_one();
+	}
+
+	//writes the snapshot still waiting and stops the writer thread
+	void close() {
+		if (!started) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			closing = true;
+		}
+		ready.notify_one();
+		writer.join();
+		started = false;
+		delete codec;
+		codec = NULL;
+	}
+
+	//snapshots replaced by a newer one before they were written, and snapshots that could not be written
+	int droppedSnapshots() const { return dropped; }
+	int failedSnapshots() const { return failed; }
+	//bytes of the cells of the snapshots written, and of what was written for them
+	long long rawCellBytes() const { return cellBytes; }
+	long long storedCellBytes() const { return writtenBytes; }
+
+private:
+	//the writer thread keeps a pointer to this, so the writer cannot be copied
+	SnapshotWriter(const SnapshotWriter &);
+	SnapshotWriter &operator=(const SnapshotWriter &);
+
+	void run() {
+		for (;;) {
+			bool last;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				while (!waiting && !closing) {
+					ready.wait(lock);
+				}
+				if (waiting) {
+					writing.swap(pending);
+				}
+				last = closing;
+				waiting = false;
+			}
+			if (!writing.empty()) {
+				if (!write()) {
+					failed++;
+				}
+				writing.clear();
+			}
+			if (last) {
+				return;
+			}
+		}
+	}
+
+	//maps the file and copies the snapshot into it, compressed or not
+	bool write() {
+		SnapshotHeader header;
+		memcpy(&header, &writing[0], sizeof(header));
+		const char *cells = &writing[sizeof(header)];
+		size_t bytes = writing.size() - sizeof(header);
+		cellBytes += bytes;
+		if (codec != NULL) {
+			codec->compress((const int8_t *)cells, (ptrdiff_t)header.width, (int)header.height, (int)header.width, compressed);
+			if (compressed.size() < bytes) {
+				header.encoding = BAND_CELLS;
+				cells = (const char *)&compressed[0];
+				bytes = compressed.size();
+			}
+		}
+		writtenBytes += bytes;
+		MappedFile file;
+		if (!file.create(part.c_str(), sizeof(header) + bytes)) {
+			return false;
+		}
+		memcpy(file.memory(), &header, sizeof(header));
+		memcpy(file.memory() + sizeof(header), cells, bytes);
+		return file.close() && replaceFile(part.c_str(), path.c_str());
+	}
+
+	std::string path;
+	std::string part;
+	bool started;
+	//only used by the writer thread
+	BandCodec *codec;
+	std::vector<uint8_t> compressed;
+	//the newest snapshot is waiting in pending until the writer thread swaps it into writing
+	std::vector<char> spare;
+	std::vector<char> pending;
+	std::vector<char> writing;
+	bool waiting;
+	bool closing;
+	int dropped;
+	int failed;
+	long long cellBytes;
+	long long writtenBytes;
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::thread writer;
+};
+
+//maps a snapshot to read it
+class SnapshotReader {
+public:
+	//returns false when path cannot be mapped, is not a snapshot of this version, or is not the size its header says
+	bool open(const char *path) {
+		if (!file.openForReading(path) || file.size() < sizeof(SnapshotHeader)) {
+			file.close();
+			return false;
+		}
+		const SnapshotHeader &h = header();
+		if (memcmp(h.magic, SNAPSHOT_MAGIC, 8) != 0 || h.version != SNAPSHOT_VERSION || h.height <= 0 || h.width <= 0 || h.generation < 0
+			|| (h.encoding == RAW_CELLS ? file.size() != sizeof(SnapshotHeader) + (size_t)(h.height * h.width) : h.encoding != BAND_CELLS)) {
+			file.close();
+			return false;
+		}
+		return true;
+	}
+
+	//unmaps the file, e.g. so a snapshot can be written over it
+	void close() {
+		file.close();
+	}
+
+	const SnapshotHeader &header() const { return *(const SnapshotHeader *)file.memory(); }
+
+	//cell (i, j) of a snapshot of RAW_CELLS is cells()[(i - 1) * width + j - 1]
+	const int8_t *cells() const { return (const int8_t *)(file.memory() + sizeof(SnapshotHeader)); }
+
+	//copies the cells into the current map of ocean, which has to be the size of the snapshot
+	//compressed cells are decompressed straight into the map, on as many threads as there are cores
+	//returns false when a cell is not a fish, a shark or empty, or the compressed cells are damaged
+	template <typename Cell>
+	bool load(Ocean<Cell> &ocean) const {
+		if (header().encoding == RAW_CELLS) {
+			return unpackCells(cells(), ocean);
+		}
+		BandCodec codec((int)std::thread::hardware_concurrency());
+		return codec.decompress((const uint8_t *)cells(), file.size() - sizeof(SnapshotHeader), ocean.oldRow(1) + 1, ocean.stride(),
+			ocean.height(), ocean.width());
+	}
+
+private:
+	MappedFile file;
+};
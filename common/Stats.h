@@ -0,0 +1,90 @@
+// Stats.h : population statistics of one generation, accumulated by the kernels while they update the ocean
+// so no extra pass over the grid is needed to display them
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+//number of set bits of a word
+inline int bitCount(uint64_t word) {
+	word = word - ((word >> 1) & 0x5555555555555555ull);
+	word = (word & 0x3333333333333333ull) + ((word >> 2) & 0x3333333333333333ull);
+	word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+	return (int)((word * 0x0101010101010101ull) >> 56);
+}
+
+//oldest fish and oldest shark, a fish of age 10 or a shark of age 20 dies in the next generation
+#define FISH_AGES 10
+#define SHARK_AGES 20
+
+//number of fields of OceanStats
+#define OCEAN_STATS_FIELDS (12 + FISH_AGES + SHARK_AGES)
+
+//what one generation did to the cells it updated
+//every field is a 64 bit count so the struct can also be sent or summed as an array of OCEAN_STATS_FIELDS integers
+struct OceanStats {
+	//population after the generation
+	int64_t fish;
+	int64_t sharks;
+	//sum of the ages of that population, for the mean ages
+	int64_t fishAges;
+	int64_t sharkAges;
+	//births
+	int64_t fishBorn;
+	int64_t sharksBorn;
+	//deaths of fish, the first rule that applies is the cause
+	int64_t eaten;
+	int64_t overcrowded;
+	int64_t fishOldAge;
+	//deaths of sharks
+	int64_t starved;
+	int64_t heartAttacks;
+	int64_t sharkOldAge;
+	//number of fish of age 1 to FISH_AGES and of sharks of age 1 to SHARK_AGES
+	//only filled by countAges, when the age structure of the generation is wanted
+	int64_t fishOfAge[FISH_AGES];
+	int64_t sharksOfAge[SHARK_AGES];
+
+	void clear() {
+		memset(this, 0, sizeof(OceanStats));
+	}
+
+	void add(const OceanStats &other) {
+		const int64_t *from = (const int64_t *)&other;
+		int64_t *to = (int64_t *)this;
+		for (int k = 0; k < OCEAN_STATS_FIELDS; k++) {
+			to[k] += from[k];
+		}
+	}
+
+	double meanFishAge() const { return fish > 0 ? (double)fishAges / fish : 0.0; }
+	double meanSharkAge() const { return sharks > 0 ? (double)sharkAges / sharks : 0.0; }
+};
+
+//displays the births, deaths and mean ages of a generation, the populations are displayed by the programs themselves
+inline void printStats(const OceanStats &stats) {
+	printf("born: %lld fish and %lld sharks, mean age: %.2f fish and %.2f sharks\n",
+		(long long)stats.fishBorn, (long long)stats.sharksBorn, stats.meanFishAge(), stats.meanSharkAge());
+	printf("died: %lld fish eaten, %lld overcrowded, %lld of old age, %lld sharks starved, %lld of a heart attack, %lld of old age\n",
+		(long long)stats.eaten, (long long)stats.overcrowded, (long long)stats.fishOldAge,
+		(long long)stats.starved, (long long)stats.heartAttacks, (long long)stats.sharkOldAge);
+}
+
+//adds the ages of the cells first..last of a row to the histograms of stats
+//called on a row right after the kernel wrote it, while it is still in the cache
+template <typename Cell>
+inline void countAges(const Cell *row, int first, int last, OceanStats &stats) {
+	//one counter per cell value from -SHARK_AGES to FISH_AGES, so there is no branch per cell
+	int64_t counts[SHARK_AGES + 1 + FISH_AGES] = { 0 };
+	for (int j = first; j <= last; j++) {
+		counts[row[j] + SHARK_AGES]++;
+	}
+	for (int a = 1; a <= FISH_AGES; a++) {
+		stats.fishOfAge[a - 1] += counts[SHARK_AGES + a];
+	}
+	for (int a = 1; a <= SHARK_AGES; a++) {
+		stats.sharksOfAge[a - 1] += counts[SHARK_AGES - a];
+	}
+}
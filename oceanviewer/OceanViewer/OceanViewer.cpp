@@ -0,0 +1,112 @@
+// OceanViewer.cpp : main project file.
+// Displays the frames that a run of any version publishes with --publish=name, from another process (see FrameChannel.h)
+
+#include "stdafx.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include "../../common/Ocean.h"
+#include "../../common/Options.h"
+#include "../../common/DensityPyramid.h"
+#include "../../common/FrameChannel.h"
+using namespace std;
+
+//default number of milliseconds between two looks at the channel, can be changed at runtime with --interval=
+//a viewer slower than the simulation displays fewer frames, the simulation does not slow down
+#define INTERVAL 100
+
+//default width of the map, can be changed at runtime with --view=
+#define VIEW_COLUMNS 64
+
+//displays the frame the viewer holds as a map at most columns characters wide, with the number of fish and sharks
+//returns false when the frame is not one this viewer knows
+bool display(const FrameViewer &viewer, int columns);
+
+int main(int argc, char *argv[])
+{
+	//--channel=name is the name given to --publish= of the simulation
+	const char *name = optionValue(argc, argv, "channel");
+	if (name == NULL) {
+		printf("usage: OceanViewer --channel=name [--interval=milliseconds] [--view=columns] [--frames=count]\n");
+		return 1;
+	}
+	int interval = intOption(argc, argv, "interval", INTERVAL);
+	int columns = intOption(argc, argv, "view", VIEW_COLUMNS);
+	//--frames=k stops after k frames, by default the viewer stops with the simulation
+	int frames = intOption(argc, argv, "frames", 0);
+
+	//the viewer can be started before the simulation, it waits for the channel to be created
+	FrameViewer viewer;
+	while (!viewer.open(name)) {
+		this_thread::sleep_for(chrono::milliseconds(interval));
+	}
+	int shown = 0;
+	for (;;) {
+		//the simulation is known to be over before looking for the last frame, so that frame is not missed
+		bool closed = viewer.closed();
+		if (viewer.update()) {
+			if (!display(viewer, columns)) {
+				printf("the channel %s holds a frame this viewer does not know\n", name);
+				return 1;
+			}
+			shown++;
+			if (frames > 0 && shown >= frames) {
+				break;
+			}
+		}
+		else if (closed) {
+			break;
+		}
+		this_thread::sleep_for(chrono::milliseconds(interval));
+	}
+	printf("displayed %d of the %llu frames published\n", shown, (unsigned long long)viewer.published());
+	return 0;
+}
+
+bool display(const FrameViewer &viewer, int columns) {
+	const PublishedFrame *frame = viewer.frame();
+	if (frame->height <= 0 || frame->width <= 0 || frame->height > INT_MAX || frame->width > INT_MAX) {
+		return false;
+	}
+	int height = (int)frame->height;
+	int width = (int)frame->width;
+	DensityPyramid *density = NULL;
+	if (frame->kind == CELL_FRAME && frame->bytes == frame->height * frame->width) {
+		//the cells are counted into tiles like the simulation does while it computes them
+		density = new DensityPyramid(height, width);
+		const int8_t *cells = (const int8_t *)viewer.frameData();
+		//row[j] is the cell of column j, from 1
+		vector<int8_t> row(width + 1);
+		for (int i = 1; i <= height; i++) {
+			memcpy(&row[1], cells + (size_t)(i - 1) * width, width);
+			density->countCells(i, &row[0], 1, width);
+		}
+		density->build();
+	}
+	else if (frame->kind == DENSITY_FRAME && frame->level >= 0 && frame->level < 27) {
+		density = new DensityPyramid(height, width, (int)frame->level);
+		size_t bytes = sizeof(DensityTile) * density->tileRows((int)frame->level) * density->tileColumns((int)frame->level);
+		if ((size_t)frame->bytes != bytes) {
+			delete density;
+			return false;
+		}
+		memcpy(density->level((int)frame->level), viewer.frameData(), bytes);
+		density->fillAbove((int)frame->level);
+	}
+	else {
+		return false;
+	}
+	//the single tile of the last level counts the whole ocean
+	const DensityTile &all = density->level(density->lastLevel())[0];
+	cout << "Generation " << frame->generation << endl;
+	cout << "there are: " << all.fish << " fish and " << all.sharks << " sharks" << endl;
+	printDensity(*density, density->levelFor(columns));
+	fflush(stdout);
+	delete density;
+	return true;
+}
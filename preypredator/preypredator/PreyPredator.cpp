@@ -1,260 +1,382 @@
-// PreyPredator.cpp : main project file.
-// Defines the entry point for the console application.
-
-#include "stdafx.h"
-#include <stdio.h>
-#include <stdlib.h>
-#include <math.h> 
-#include <iostream>
-#include <time.h> 
-#include <array>
-using namespace std;
-
-//speed selected will print every nth generation (1,10 or 100)
-#define FAST 100
-#define MEDIUM 10
-#define SLOW 1
-
-//array dimensions
-#define HEIGHT 1024
-#define WIDTH 2048
-
-//total number of steps to be done
-#define NUMBER_OF_STEPS 500
-
-//global map with 2 extra rows and 2 extra columns to deal with boundaries
-int oldMap[HEIGHT + 2][WIDTH + 2] = { 0 };
-
-int newMap[HEIGHT + 2][WIDTH + 2];
-
-//ages all the fish and sharks, kills the ones that should die, and spawns the ones that are bred 
-//all changes are stored in newMap and then copied into oldMap afterwards
-void update();
-
-//displays the whole grid to the console
-void print();
-//returns the number of fish and sharks as a pair (fish, shark) in the whole ocean
-pair<int,int> analyze();
-//returns the number of neighboring fish and sharks and specifies how many are adults  of a given cell
-//where i and j specify the location of that cell
-//the returned format will be in an array of four numbers:
-//number of all neighboring fish, number of adult neighboring fish, number of all neighboring sharks, number of adult neighboring sharks)
-array<int, 4>  neighborCount(int i, int j);
-void evaluate(int value, int &fish, int &adultFish, int &sharks, int &adultSharks);
-
-int main()
-{
-	clock_t t1, t2;
-	t1 = clock();
-
-	//setting the speed
-	int speed = FAST;
-	
-	int i, j = 0;
-	float randFloat;
-	//initializing the array with 50% fish, 25% sharks, and 25% empty cells
-	//note that the borders (2 rows and 2 columns) are left empty as they will be overwritten next
-	for (i = 1; i <= HEIGHT; i++) {
-		for (j = 1; j <= WIDTH; j++) {
-			randFloat = rand() / ((float)RAND_MAX + 1);
-			if (randFloat<0.25) {
-				//25% are empty
-				oldMap[i][j] = 0;
-			}
-			else if(randFloat>=0.25 && randFloat<0.5) {
-				//25% are sharks
-				oldMap[i][j] = -1;
-			}
-			else {
-				//50% are fish
-				oldMap[i][j] = 1;
-			}
-		}
-	}
-	
-	//to repeat the simulation NUMBER_OF_STEPS of times
-	for (int n = 0; n <= NUMBER_OF_STEPS; n++) {
-		//now we need to copy the edges to simulate an infinite ocean
-		//starting with the corners (to not go over them twice if we loop vertically and horizontally)
-		oldMap[0][0] = oldMap[HEIGHT][WIDTH];
-		oldMap[0][WIDTH + 1] = oldMap[HEIGHT][1];
-		oldMap[HEIGHT + 1][WIDTH + 1] = oldMap[1][1];
-		oldMap[HEIGHT + 1][0] = oldMap[1][WIDTH];
-		/* left-right boundary conditions */
-		for (i = 1; i <= HEIGHT; i++) {
-			oldMap[i][0] = oldMap[i][WIDTH];
-			oldMap[i][WIDTH + 1] = oldMap[i][1];
-		}
-		/* top-bottom boundary conditions */
-		for (j = 1; j <= WIDTH; j++) {
-			oldMap[0][j] = oldMap[HEIGHT][j];
-			oldMap[HEIGHT + 1][j] = oldMap[1][j];
-		}
-
-		//print();
-		//going through the entire 2D array
-		update();
-		if (n%speed == 0) {
-			cout << "Generation " << n << endl;
-			cout << "there are: " << analyze().first << " fish and " << analyze().second << " sharks" << endl;
-			//uncomment this on small numbers like 20x50 grids
-			//print();
-			
-		}
-	}
-	//when all the time steps are complete
-	t2 = clock();
-	//displaying the ascii visualization is only viable when width and height are small enough
-	//print();
-
-	float diff((float)t2 - (float)t1);
-	cout << "Serial processing of a " << WIDTH << "x" << HEIGHT << " grid. Performing " << NUMBER_OF_STEPS << " iterations." << endl;
-	printf("Processing time %f seconds \n", (diff/1000));
-	system("pause");
-	return 0;
-}
-
-void print() {
-	for (int i = 1; i < HEIGHT +1; i++) {  
-		for (int j = 1; j < WIDTH+1; j++) {
-			//cout << " ";
-			if (oldMap[i][j] > 0) {
-				cout << "f";// << oldMap[i][j];
-			} else if (oldMap[i][j] < 0) {
-				cout << "s";
-			} else {
-				cout << "-";
-			}
-			//cout << " ";
-		}
-		cout << endl;
-	}
-	cout << endl;
-}
-
-pair<int, int> analyze() {
-	int numOfFish = 0;
-	int numOfSharks = 0;
-	for (int i = 1; i <= HEIGHT; i++) {
-		for (int j = 1; j <= WIDTH; j++) {
-			//negative numbers represent sharks, and positive numbers represent fish
-			//absolute value represents the age
-			if (oldMap[i][j] < 0) {
-				numOfSharks++;
-			}
-			if (oldMap[i][j] > 0) {
-				numOfFish++;
-			}
-		}
-	}
-	return pair<int,int>(numOfFish, numOfSharks);
-}
-
-array<int,4> neighborCount(int i, int j) {
-	int fish = 0;
-	int adultFish = 0;
-	int sharks = 0;
-	int adultSharks = 0;
-
-	//to ensure that the function is not given a boundary cell
-	if (i <= 0 || j <= 0 || (i >= HEIGHT + 1) || (j >= WIDTH + 1)) {
-		cout << "passed an invalid cell to neighborCount" << endl;
-		//return NULL;
-	}
-	//1  2  3
-	//4  X  5
-	//6  7  8
-	evaluate(oldMap[i - 1][j - 1], fish, adultFish, sharks, adultSharks); //neighbor 1
-	evaluate(oldMap[  i  ][j - 1], fish, adultFish, sharks, adultSharks); //neighbor 2
-	evaluate(oldMap[i + 1][j - 1], fish, adultFish, sharks, adultSharks); //neighbor 3
-
-	evaluate(oldMap[i - 1][j], fish, adultFish, sharks, adultSharks);	  //neighbor 4
-	evaluate(oldMap[i + 1][j], fish, adultFish, sharks, adultSharks);	  //neighbor 5
-
-	evaluate(oldMap[i - 1][j + 1], fish, adultFish, sharks, adultSharks); //neighbor 6
-	evaluate(oldMap[  i  ][j + 1], fish, adultFish, sharks, adultSharks); //neighbor 7
-	evaluate(oldMap[i + 1][j + 1], fish, adultFish, sharks, adultSharks); //neighbor 8
-
-	array<int,4> neighbors = { fish,adultFish,sharks,adultSharks };
-	return neighbors;
-}
-
-void evaluate(int value, int &fish, int &adultFish, int &sharks, int &adultSharks) {
-	//cout << "value: " << value << " fish: " << fish << " aFish: " << adultFish << " sharks: " << sharks << endl;
-	if (value == 0) { //empty cell
-		return;
-	}
-	if (value > 0) { // fish
-		fish++;
-		if (value >= 2){ // adult fish
-			adultFish++;
-		}
-	}
-	if (value < 0) { //shark
-		sharks++;
-		if (value <= -3) { //adult shark
-			adultSharks++;
-		}
-	}
-}
-
-void update() {
-	//i and j will be used in the for loops
-	//nFish is the number of neighboring fish, nAdultFish is the number of neighboring adult fish
-	//nSharks is the number of neighboring sharks, nAdultSharks is the number of neighboring adult sharks
-	int i, j, nFish, nAdultFish, nSharks, nAdultSharks = 0;
-	for (i = 1; i <= HEIGHT; i++) {
-		for (j = 1; j <= WIDTH; j++) {
-			//for each cell we count how many neighbors it has
-			array<int,4> neighborsArr = neighborCount(i,j);
-			nFish = neighborsArr[0];
-			nAdultFish = neighborsArr[1];
-			nSharks = neighborsArr[2];
-			nAdultSharks = neighborsArr[3];
-
-			if (oldMap[i][j] > 0) { //fish
-				//implementing all the fish rules
-				//a fish can die by being eaten, overpopulation, or old age
-				if (nSharks >= 5 || nFish == 8 || oldMap[i][j]>=10) {
-					newMap[i][j] = 0; //fish dies 
-				}
-				else {
-					//the fish survived, we increment its age
-					newMap[i][j] = oldMap[i][j] + 1;
-				}
-			}
-			else if (oldMap[i][j] < 0) { //shark
-				//implementing all the shark rules
-				float sharkHeartAttack;
-				sharkHeartAttack = rand() / ((float)RAND_MAX + 1);
-				//a shark can die by either starvation or randomly or because of old age
-				if ((nSharks >= 6 && nFish == 0)||(sharkHeartAttack<=0.031) || (oldMap[i][j]<=-20) ) {
-					newMap[i][j] = 0; //shark dies
-				}
-				else {
-					//shark survives, increment age by making the cell's value more negative
-					newMap[i][j] = oldMap[i][j] - 1;
-				}
-			}
-			else { //empty
-				//breeding rules
-				if (nFish >= 4 && nAdultFish >= 3 && nSharks < 4) {
-					newMap[i][j] = 1; //a fish is born
-				}
-				else if (nSharks >= 4 && nAdultSharks >= 3 && nFish < 4) {
-					newMap[i][j] = -1; //a shark is born
-				}
-				else {
-					//nothing is born
-					newMap[i][j] = oldMap[i][j]; //or set it to 0 (since this cell was empty and will remain empty)
-				}
-			}
-		}
-	}
-	//now we copy the new map into the old map
-	for (i = 1; i <= HEIGHT; i++) {
-		for (j = 1; j <= WIDTH; j++) {
-			oldMap[i][j] = newMap[i][j];	
-		}
-	}
+// PreyPredator.cpp : main project file.
+// Defines the entry point for the console application.
+
+#include "stdafx.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h> 
+#include <iostream>
+#include <time.h> 
+#include <array>
+#include "../../common/Ocean.h"
+#include "../../common/Options.h"
+#include "../../common/Kernel.h"
+#include "../../common/Random.h"
+#include "../../common/Bitboard.h"
+#include "../../common/Stats.h"
+#include "../../common/Series.h"
+#include "../../common/Snapshot.h"
+#include "../../common/GenerationLog.h"
+#include "../../common/DensityPyramid.h"
+#include "../../common/FrameChannel.h"
+using namespace std;
+
+//speed selected will print every nth generation (1,10 or 100)
+#define FAST 100
+#define MEDIUM 10
+#define SLOW 1
+
+//default array dimensions, can be changed at runtime with --height= and --width=
+#define HEIGHT 1024
+#define WIDTH 2048
+
+//default total number of steps to be done, can be changed at runtime with --steps=
+#define NUMBER_OF_STEPS 500
+
+//default seed of the random numbers, can be changed at runtime with --seed=
+//the same seed gives the same ocean whatever the number of threads or processes
+#define SEED 1
+
+//default number of generations between two snapshots with --snapshot=, can be changed at runtime with --snapshots=
+#define SNAPSHOT_INTERVAL 100
+
+//default number of generations between two keyframes of a log with --record=, can be changed at runtime with --keyframes=
+#define KEYFRAME_INTERVAL 100
+
+//ages all the fish and sharks, kills the ones that should die, and spawns the ones that are bred 
+//all changes are stored in newMap, which then becomes the current map by swapping the two buffers
+//the rules themselves are applied row by row by the kernel (see Kernel.h)
+//seed and generation select the random numbers of the sharks (see Random.h)
+//the populations, births and deaths of the new generation are added to stats by the kernel, in the same sweep
+//when ages is true the age histograms are added too, each row is counted right after it is computed
+//and when density is not NULL the fish and sharks of each row are counted into its tiles the same way (see DensityPyramid.h)
+void update(Ocean<cell_t> &ocean, RowKernel<cell_t>::Function kernel, uint32_t seed, int generation, OceanStats &stats, bool ages, DensityPyramid *density);
+//same as update but with the ocean stored as bit planes (see Bitboard.h)
+void update(BitOcean &ocean, uint32_t seed, int generation, OceanStats &stats, bool ages, DensityPyramid *density);
+
+//displays the whole grid to the console
+void print(Ocean<cell_t> &ocean);
+//returns the number of fish and sharks as a pair (fish, shark) in the whole ocean
+//no longer needed every displayed generation since update counts them, kept to check the counts of the kernels
+pair<int,int> analyze(Ocean<cell_t> &ocean);
+pair<int,int> analyze(BitOcean &ocean);
+
+int main(int argc, char *argv[])
+{
+	clock_t t1, t2;
+	t1 = clock();
+
+	//setting the speed, --speed=1 displays the statistics of every generation
+	int speed = intOption(argc, argv, "speed", FAST);
+	if (speed < 1) {
+		printf("--speed has to be at least 1\n");
+		return 1;
+	}
+
+	int height = intOption(argc, argv, "height", HEIGHT);
+	int width = intOption(argc, argv, "width", WIDTH);
+	int numberOfSteps = intOption(argc, argv, "steps", NUMBER_OF_STEPS);
+	uint32_t seed = (uint32_t)intOption(argc, argv, "seed", SEED);
+	if (height < 1 || width < 1 || numberOfSteps < 1) {
+		printf("--height, --width and --steps have to be at least 1\n");
+		return 1;
+	}
+	//the first generation to compute, a restarted run goes on from the generation of its snapshot
+	int first = 0;
+
+	//--restart=file goes on from a snapshot written by --snapshot= (see Snapshot.h)
+	//the size of the ocean, the seed and the generation are the ones of the snapshot
+	SnapshotReader restart;
+	const char *restartPath = optionValue(argc, argv, "restart");
+	if (restartPath != NULL) {
+		if (!restart.open(restartPath) || restart.header().generation > INT_MAX) {
+			printf("%s is not a snapshot\n", restartPath);
+			return 1;
+		}
+		height = (int)restart.header().height;
+		width = (int)restart.header().width;
+		seed = (uint32_t)restart.header().seed;
+		first = (int)restart.header().generation;
+	}
+	//--replay=file goes on from a state of a log written by --record= (see GenerationLog.h), the state given by --generation=
+	//or the first one of the log, it is rebuilt from the keyframe before it and the deltas in between
+	GenerationLog replay;
+	const char *replayPath = optionValue(argc, argv, "replay");
+	if (replayPath != NULL) {
+		if (restartPath != NULL) {
+			printf("--restart and --replay cannot be used together\n");
+			return 1;
+		}
+		if (!replay.open(replayPath)) {
+			printf("%s is not a log of generations\n", replayPath);
+			return 1;
+		}
+		int generation = intOption(argc, argv, "generation", (int)replay.firstState());
+		if (!replay.rebuild(generation)) {
+			printf("%s does not hold generation %d\n", replayPath, generation);
+			return 1;
+		}
+		height = replay.height();
+		width = replay.width();
+		seed = replay.seed();
+		first = generation;
+	}
+
+	//map with 2 extra rows and 2 extra columns to deal with boundaries
+	Ocean<cell_t> ocean(height, width);
+
+	//the AVX2 kernel is used when the processor supports it, unless --kernel=scalar is given
+	//--rules= picks one of the rule sets compiled into the program (see Rules.h)
+	const char *rules = optionValue(argc, argv, "rules");
+	if (rules == NULL) {
+		rules = DEFAULT_RULES;
+	}
+	RowKernel<cell_t>::Function kernel = selectRowKernel<cell_t>(optionIs(argc, argv, "kernel", "scalar"), rules);
+	if (kernel == NULL) {
+		printf("unknown rules %s, the rules are:", rules);
+		printRuleNames();
+		return 1;
+	}
+	//--kernel=bitboard runs the whole simulation on bit planes instead (see Bitboard.h),
+	//on AVX2 vectors when the processor supports them or on 64 bit words with --kernel=bitboard64
+	BitOcean *bitOcean = NULL;
+
+	//--series=file writes the statistics and age histograms of every generation to file, as CSV or binary when it ends in .bin
+	SeriesWriter series;
+	const char *seriesPath = optionValue(argc, argv, "series");
+	if (seriesPath != NULL && !series.open(seriesPath)) {
+		printf("cannot create %s\n", seriesPath);
+		return 1;
+	}
+	//--snapshot=file saves the ocean to file every --snapshots= generations and after the last one, for --restart=
+	//the cells are copied after the swap and a background thread writes them through a mapped file
+	//--compress=k has k threads compress the cells of every snapshot before they are written (see BandCodec.h)
+	SnapshotWriter snapshots;
+	const char *snapshotPath = optionValue(argc, argv, "snapshot");
+	int snapshotInterval = intOption(argc, argv, "snapshots", SNAPSHOT_INTERVAL);
+	int compressThreads = intOption(argc, argv, "compress", 0);
+	if (snapshotPath != NULL) {
+		snapshots.start(snapshotPath, compressThreads);
+	}
+	//--record=file records every generation to file, a keyframe every --keyframes= generations and only the cells
+	//that changed occupant in between, with an index of the keyframes in file.idx so --replay= can rebuild any of them
+	GenerationRecorder recorder;
+	const char *recordPath = optionValue(argc, argv, "record");
+	if (recordPath != NULL && !recorder.open(recordPath, height, width, seed, intOption(argc, argv, "keyframes", KEYFRAME_INTERVAL))) {
+		printf("cannot create %s\n", recordPath);
+		return 1;
+	}
+	//--view=columns displays a map of the ocean at most columns characters wide with the statistics,
+	//from the tiles of a density pyramid counted while the displayed generations are computed
+	int viewColumns = intOption(argc, argv, "view", 0);
+	DensityPyramid *density = viewColumns > 0 ? new DensityPyramid(height, width) : NULL;
+	int viewLevel = density != NULL ? density->levelFor(viewColumns) : 0;
+	//--publish=name hands every displayed generation to a viewer through the shared memory called name (see FrameChannel.h),
+	//the tiles of the map with --view= and otherwise all the cells, the simulation never waits for the viewer
+	FramePublisher publisher;
+	const char *publishName = optionValue(argc, argv, "publish");
+	if (publishName != NULL) {
+		size_t capacity = density != NULL ? sizeof(DensityTile) * density->tileRows(viewLevel) * density->tileColumns(viewLevel) : (size_t)height * width;
+		if (!publisher.open(publishName, capacity)) {
+			printf("cannot create the shared memory %s\n", publishName);
+			return 1;
+		}
+	}
+	
+	if (restartPath != NULL) {
+		if (!restart.load(ocean)) {
+			printf("%s holds a value that is not a cell\n", restartPath);
+			return 1;
+		}
+		restart.close();
+	}
+	else if (replayPath != NULL) {
+		if (!replay.load(ocean)) {
+			printf("%s holds a value that is not a cell\n", replayPath);
+			return 1;
+		}
+		replay.close();
+	}
+	else {
+		int i, j = 0;
+		//initializing the array with 50% fish, 25% sharks, and 25% empty cells
+		//note that the borders (2 rows and 2 columns) are left empty as they will be overwritten next
+		for (i = 1; i <= height; i++) {
+			cell_t *row = ocean.oldRow(i);
+			for (j = 1; j <= width; j++) {
+				row[j] = initialCell<cell_t>(seed, i, j);
+			}
+		}
+	}
+	
+	if (optionIs(argc, argv, "kernel", "bitboard") || optionIs(argc, argv, "kernel", "bitboard64")) {
+		bitOcean = new BitOcean(height, width, optionIs(argc, argv, "kernel", "bitboard64"), rules);
+		bitOcean->load(ocean);
+	}
+
+	//the starting state is the first one of the log
+	if (recorder.isOpen()) {
+		recorder.record(ocean, first);
+	}
+	//to repeat the simulation numberOfSteps of times
+	for (int n = first; n <= numberOfSteps; n++) {
+		OceanStats stats;
+		stats.clear();
+		if (bitOcean != NULL) {
+			bitOcean->wrapBoundaries();
+			update(*bitOcean, seed, n, stats, series.isOpen(), n%speed == 0 ? density : NULL);
+		}
+		else {
+			//now we need to copy the edges to simulate an infinite ocean
+			ocean.wrapBoundaries();
+
+			//print(ocean);
+			//going through the entire 2D array
+			update(ocean, kernel, seed, n, stats, series.isOpen(), n%speed == 0 ? density : NULL);
+		}
+		if (series.isOpen()) {
+			series.write(n, stats);
+		}
+		//the next generation to compute is n + 1
+		bool snapshot = snapshots.isOpen() && ((snapshotInterval > 0 && (n + 1) % snapshotInterval == 0) || n == numberOfSteps);
+		//the cells are published without a map
+		bool publish = publisher.isOpen() && density == NULL && n%speed == 0;
+		//the bit planes are converted back into the ocean first
+		if (bitOcean != NULL && (snapshot || recorder.isOpen() || publish)) {
+			bitOcean->store(ocean);
+		}
+		if (snapshot) {
+			snapshots.capture(ocean, n + 1, seed);
+		}
+		if (recorder.isOpen()) {
+			recorder.record(ocean, n + 1);
+		}
+		if (publish) {
+			publisher.publishCells(ocean, n);
+		}
+		if (n%speed == 0) {
+			//pair<int, int> members = bitOcean != NULL ? analyze(*bitOcean) : analyze(ocean);
+			cout << "Generation " << n << endl;
+			cout << "there are: " << stats.fish << " fish and " << stats.sharks << " sharks" << endl;
+			printStats(stats);
+			if (density != NULL) {
+				density->build();
+				printDensity(*density, viewLevel);
+				if (publisher.isOpen()) {
+					publisher.publishDensity(*density, viewLevel, n);
+				}
+			}
+			//uncomment this on small numbers like 20x50 grids
+			//print(ocean);
+			
+		}
+	}
+	//when all the time steps are complete
+	t2 = clock();
+	//the records still queued are written after the clock is stopped
+	series.close();
+	snapshots.close();
+	if (snapshots.droppedSnapshots() > 0 || snapshots.failedSnapshots() > 0) {
+		printf("%d snapshots were replaced by newer ones before they were written, %d could not be written\n",
+			snapshots.droppedSnapshots(), snapshots.failedSnapshots());
+	}
+	if (compressThreads > 0 && snapshots.rawCellBytes() > 0) {
+		printf("the snapshots took %.1f%% of the size of their cells\n", 100.0 * snapshots.storedCellBytes() / snapshots.rawCellBytes());
+	}
+	if (publisher.isOpen()) {
+		publisher.close();
+		printf("%llu frames were replaced by newer ones before the viewer took them\n", (unsigned long long)publisher.droppedFrames());
+	}
+	if (recorder.isOpen()) {
+		if (!recorder.close()) {
+			printf("cannot write %s\n", recordPath);
+		}
+		printf("recorded %d keyframes and %d deltas, %lld bytes\n", recorder.keyframeCount(), recorder.deltaCount(), (long long)recorder.bytes());
+	}
+	//displaying the ascii visualization is only viable when width and height are small enough
+	//print(ocean);
+	//with the bitboard engine the ocean has to be converted back first
+	//bitOcean->store(ocean);
+
+	float diff((float)t2 - (float)t1);
+	cout << "Serial processing of a " << width << "x" << height << " grid. Performing " << numberOfSteps << " iterations." << endl;
+	cout << "using the " << (bitOcean != NULL ? bitOcean->name() : rowKernelName<cell_t>(kernel)) << " kernel with the " << rules << " rules" << endl;
+	delete bitOcean;
+	delete density;
+	printf("Processing time %f seconds \n", (diff/1000));
+	system("pause");
+	return 0;
+}
+
+void print(Ocean<cell_t> &ocean) {
+	for (int i = 1; i < ocean.height() + 1; i++) {
+		const cell_t *row = ocean.oldRow(i);
+		for (int j = 1; j < ocean.width() + 1; j++) {
+			//cout << " ";
+			if (row[j] > 0) {
+				cout << "f";// << row[j];
+			} else if (row[j] < 0) {
+				cout << "s";
+			} else {
+				cout << "-";
+			}
+			//cout << " ";
+		}
+		cout << endl;
+	}
+	cout << endl;
+}
+
+pair<int, int> analyze(Ocean<cell_t> &ocean) {
+	int numOfFish = 0;
+	int numOfSharks = 0;
+	for (int i = 1; i <= ocean.height(); i++) {
+		const cell_t *row = ocean.oldRow(i);
+		for (int j = 1; j <= ocean.width(); j++) {
+			//negative numbers represent sharks, and positive numbers represent fish
+			//absolute value represents the age
+			if (row[j] < 0) {
+				numOfSharks++;
+			}
+			if (row[j] > 0) {
+				numOfFish++;
+			}
+		}
+	}
+	return pair<int,int>(numOfFish, numOfSharks);
+}
+
+void update(Ocean<cell_t> &ocean, RowKernel<cell_t>::Function kernel, uint32_t seed, int generation, OceanStats &stats, bool ages, DensityPyramid *density) {
+	//each row only needs the row above and the row below it
+	for (int i = 1; i <= ocean.height(); i++) {
+		kernel(ocean.oldRow(i - 1), ocean.oldRow(i), ocean.oldRow(i + 1), ocean.newRow(i), 1, ocean.width(), rowRandom(seed, generation, i, 0), stats);
+		if (ages) {
+			countAges(ocean.newRow(i), 1, ocean.width(), stats);
+		}
+		if (density != NULL) {
+			density->countCells(i, ocean.newRow(i), 1, ocean.width());
+		}
+	}
+	//the new map becomes the current one, no copying needed
+	ocean.swap();
+}
+
+void update(BitOcean &ocean, uint32_t seed, int generation, OceanStats &stats, bool ages, DensityPyramid *density) {
+	for (int i = 1; i <= ocean.height(); i++) {
+		ocean.updateRow(i, rowRandom(seed, generation, i, 0), stats);
+		if (ages) {
+			ocean.countAges(i, stats);
+		}
+		if (density != NULL) {
+			ocean.countDensity(i, *density);
+		}
+	}
+	ocean.swap();
+}
+
+pair<int, int> analyze(BitOcean &ocean) {
+	int numOfFish, numOfSharks;
+	ocean.count(1, ocean.height(), numOfFish, numOfSharks);
+	return pair<int, int>(numOfFish, numOfSharks);
 }
\ No newline at end of file
@@ -0,0 +1,144 @@
+// Checkpoint.h : saves the ocean of a run to a file and starts a run again from it
+// every process writes and reads its own block of one shared file with collective MPI-IO, nothing goes through process 0,
+// and the file holds the whole ocean row by row so a run can be restarted with any number of processes
+
+#pragma once
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include "../../common/Ocean.h"
+#include "../../common/Stats.h"
+#include "Decomposition.h"
+
+//first bytes of a checkpoint
+#define CHECKPOINT_MAGIC "OCEANCKP"
+//changes whenever the layout of the file changes
+#define CHECKPOINT_VERSION 1
+
+//the header of a checkpoint, followed by the height*width cells of the ocean row by row
+//with 1 byte cells (cell_t is int8_t) the cells are the same as a file given to --initial
+//the random numbers depend only on the seed, the generation and the position of a cell, so this is all a run needs to go on
+struct CheckpointHeader {
+	char magic[8];
+	int64_t version;
+	int64_t cellBytes;
+	int64_t height;
+	int64_t width;
+	//the next generation to compute
+	int64_t generation;
+	int64_t seed;
+};
+
+//the block of the process inside the whole ocean of the file
+inline MPI_Datatype checkpointFileType(const Decomposition &d) {
+	int sizes[2] = { d.oceanHeight, d.oceanWidth };
+	int subsizes[2] = { d.height, d.width };
+	int starts[2] = { d.firstRow - 1, d.firstColumn - 1 };
+	MPI_Datatype type;
+	MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, MPI_CELL, &type);
+	MPI_Type_commit(&type);
+	return type;
+}
+
+//the block of the process inside its map, without the extra cells
+inline MPI_Datatype checkpointMapType(const Decomposition &d, const Ocean<cell_t> &ocean) {
+	MPI_Datatype type;
+	MPI_Type_vector(d.height, d.width, ocean.stride(), MPI_CELL, &type);
+	MPI_Type_commit(&type);
+	return type;
+}
+
+//writes the current map of every process to path, generation is the next one to compute, returns false when the file cannot be written
+//the file is written as path.part first and renamed once complete, so a run stopped while writing keeps the previous checkpoint
+inline bool writeCheckpoint(const char *path, const Decomposition &d, Ocean<cell_t> &ocean, int generation, uint32_t seed) {
+	std::string part = std::string(path) + ".part";
+	MPI_File file;
+	if (MPI_File_open(d.comm, (char *)part.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+		return false;
+	}
+	//a longer file left by an earlier run is cut to the size of this one
+	MPI_File_set_size(file, (MPI_Offset)sizeof(CheckpointHeader) + (MPI_Offset)d.oceanHeight * d.oceanWidth * sizeof(cell_t));
+	int ok = 1;
+	if (d.rank == 0) {
+		CheckpointHeader header;
+		memcpy(header.magic, CHECKPOINT_MAGIC, 8);
+		header.version = CHECKPOINT_VERSION;
+		header.cellBytes = sizeof(cell_t);
+		header.height = d.oceanHeight;
+		header.width = d.oceanWidth;
+		header.generation = generation;
+		header.seed = seed;
+		if (MPI_File_write_at(file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE) != MPI_SUCCESS) {
+			ok = 0;
+		}
+	}
+	//every process sees the file as its block of the ocean, and all of them write at once
+	MPI_Datatype fileType = checkpointFileType(d);
+	MPI_Datatype mapType = checkpointMapType(d, ocean);
+	MPI_File_set_view(file, sizeof(CheckpointHeader), MPI_CELL, fileType, (char *)"native", MPI_INFO_NULL);
+	if (MPI_File_write_at_all(file, 0, ocean.oldRow(1) + 1, 1, mapType, MPI_STATUS_IGNORE) != MPI_SUCCESS) {
+		ok = 0;
+	}
+	MPI_File_close(&file);
+	MPI_Type_free(&fileType);
+	MPI_Type_free(&mapType);
+	MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, d.comm);
+	if (ok && d.rank == 0) {
+		//rename does not replace an existing file on Windows
+		if (rename(part.c_str(), path) != 0) {
+			remove(path);
+			ok = rename(part.c_str(), path) == 0;
+		}
+	}
+	MPI_Bcast(&ok, 1, MPI_INT, 0, d.comm);
+	return ok != 0;
+}
+
+//reads the header of the checkpoint path on every process of comm
+//returns false when the file cannot be read, is not a checkpoint of this version or of these cells, or is not the size the header says
+inline bool readCheckpointHeader(const char *path, MPI_Comm comm, CheckpointHeader &header) {
+	MPI_File file;
+	if (MPI_File_open(comm, (char *)path, MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+		return false;
+	}
+	MPI_Offset size;
+	MPI_File_get_size(file, &size);
+	memset(&header, 0, sizeof(header));
+	bool ok = size >= (MPI_Offset)sizeof(header)
+		&& MPI_File_read_at_all(file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+	MPI_File_close(&file);
+	return ok && memcmp(header.magic, CHECKPOINT_MAGIC, 8) == 0 && header.version == CHECKPOINT_VERSION
+		&& header.cellBytes == (int64_t)sizeof(cell_t) && header.height > 0 && header.width > 0
+		&& size == (MPI_Offset)sizeof(header) + (MPI_Offset)(header.height * header.width * header.cellBytes);
+}
+
+//reads the block of every process from the checkpoint path into its current map, the header has to have been checked
+//returns false on every process when one of them could not read its block or found a value that is not a cell in it
+inline bool readCheckpoint(const char *path, const Decomposition &d, Ocean<cell_t> &ocean) {
+	MPI_File file;
+	if (MPI_File_open(d.comm, (char *)path, MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+		return false;
+	}
+	MPI_Datatype fileType = checkpointFileType(d);
+	MPI_Datatype mapType = checkpointMapType(d, ocean);
+	MPI_File_set_view(file, sizeof(CheckpointHeader), MPI_CELL, fileType, (char *)"native", MPI_INFO_NULL);
+	int ok = MPI_File_read_at_all(file, 0, ocean.oldRow(1) + 1, 1, mapType, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+	MPI_File_close(&file);
+	MPI_Type_free(&fileType);
+	MPI_Type_free(&mapType);
+	//the kernels look the cells up in tables, so a damaged file must not reach them
+	for (int i = 1; i <= d.height && ok; i++) {
+		const cell_t *row = ocean.oldRow(i);
+		for (int j = 1; j <= d.width; j++) {
+			if (row[j] < -SHARK_AGES || row[j] > FISH_AGES) {
+				ok = 0;
+				break;
+			}
+		}
+	}
+	MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, d.comm);
+	return ok != 0;
+}
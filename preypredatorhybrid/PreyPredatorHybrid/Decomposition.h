@@ -0,0 +1,645 @@
+// Decomposition.h : splits the ocean into a 2D grid of blocks, one per process, and exchanges the halos of the blocks
+// the processes form a periodic cartesian communicator, so the ocean stays a torus whatever the number of processes
+
+#pragma once
+
+#include <mpi.h>
+#include <string.h>
+#include <vector>
+#include "../../common/Ocean.h"
+#include "../../common/BandCodec.h"
+
+//MPI datatype matching cell_t, used whenever cells are sent between processes
+inline MPI_Datatype mpiCellType(int8_t) { return MPI_SIGNED_CHAR; }
+inline MPI_Datatype mpiCellType(int) { return MPI_INT; }
+#define MPI_CELL mpiCellType(cell_t())
+
+//first tag of the halo messages, a message going in direction d has the tag HALO_TAG + d
+#define HALO_TAG 4000
+//tag of the blocks sent by gatherOcean
+#define GATHER_TAG 3999
+//tag of the cells sent by migrateCells
+#define MIGRATE_TAG 4200
+
+//the blocks are only rebalanced when the busiest process took that much longer than the mean to update its cells
+#define BALANCE_TOLERANCE 1.05
+
+//the 8 neighbors of a block, the opposite of direction d is d ^ 1
+enum Direction {
+	NORTH, SOUTH,
+	WEST, EAST,
+	NORTH_WEST, SOUTH_EAST,
+	NORTH_EAST, SOUTH_WEST,
+	DIRECTIONS
+};
+
+//row and column steps of every direction
+const int directionRow[DIRECTIONS] = { -1, 1, 0, 0, -1, 1, -1, 1 };
+const int directionColumn[DIRECTIONS] = { 0, 0, -1, 1, -1, 1, 1, -1 };
+
+//first of the size cells of a dimension split into parts, for part index (0 based)
+inline int blockStart(int size, int parts, int index) {
+	return (int)((long long)index * size / parts);
+}
+
+//the block of the ocean owned by this process and the processes around it
+struct Decomposition {
+	//periodic 2D communicator, the ranks are the same as in MPI_COMM_WORLD
+	MPI_Comm comm;
+	int rank;
+	//size of the whole ocean
+	int oceanHeight;
+	int oceanWidth;
+	//number of blocks down and across, and the position of this block
+	int dims[2];
+	int coords[2];
+	//size of the block, and its first row and column in the whole ocean (1 based like the ocean)
+	int height;
+	int width;
+	int firstRow;
+	int firstColumn;
+	//rank of the process in every direction, can be this process or twice the same process on small grids
+	int neighbor[DIRECTIONS];
+	//first row (0 based) of every row of blocks and first column of every column of blocks, followed by the size of the ocean
+	//every row of blocks has the same rows and every column of blocks the same columns, so the blocks stay a grid when they move
+	std::vector<int> rowCuts;
+	std::vector<int> columnCuts;
+};
+
+//the block of any process: its first row and column in the whole ocean and its size
+inline void blockOf(const Decomposition &d, int rank, int &firstRow, int &firstColumn, int &height, int &width) {
+	int coords[2];
+	MPI_Cart_coords(d.comm, rank, 2, coords);
+	height = d.rowCuts[coords[0] + 1] - d.rowCuts[coords[0]];
+	width = d.columnCuts[coords[1] + 1] - d.columnCuts[coords[1]];
+	firstRow = d.rowCuts[coords[0]] + 1;
+	firstColumn = d.columnCuts[coords[1]] + 1;
+}
+
+//the grid of blocks is chosen by MPI_Dims_create for any number of processes
+//the dimension with more blocks goes along the longer side of the ocean so the blocks stay close to square
+inline Decomposition decompose(int height, int width, int nprocs) {
+	Decomposition d;
+	int dims[2] = { 0, 0 };
+	MPI_Dims_create(nprocs, 2, dims);
+	//MPI_Dims_create returns the larger dimension first
+	if (width > height) {
+		int temp = dims[0];
+		dims[0] = dims[1];
+		dims[1] = temp;
+	}
+	int periods[2] = { 1, 1 };
+	MPI_Cart_create(MPI_COMM_WORLD, 2, dims, periods, 0, &d.comm);
+	MPI_Comm_rank(d.comm, &d.rank);
+	MPI_Cart_coords(d.comm, d.rank, 2, d.coords);
+	d.dims[0] = dims[0];
+	d.dims[1] = dims[1];
+	d.oceanHeight = height;
+	d.oceanWidth = width;
+	//the blocks start as even as possible, balanceBlocks moves the cuts later
+	for (int k = 0; k <= dims[0]; k++) {
+		d.rowCuts.push_back(blockStart(height, dims[0], k));
+	}
+	for (int k = 0; k <= dims[1]; k++) {
+		d.columnCuts.push_back(blockStart(width, dims[1], k));
+	}
+	blockOf(d, d.rank, d.firstRow, d.firstColumn, d.height, d.width);
+
+	//the communicator is periodic, so MPI_Cart_rank wraps the coordinates of the blocks on the edges
+	for (int k = 0; k < DIRECTIONS; k++) {
+		int coords[2] = { d.coords[0] + directionRow[k], d.coords[1] + directionColumn[k] };
+		MPI_Cart_rank(d.comm, coords, &d.neighbor[k]);
+	}
+	return d;
+}
+
+//an ocean with more blocks than rows or columns would leave some processes without cells
+inline bool validDecomposition(const Decomposition &d) {
+	return d.oceanHeight >= d.dims[0] && d.oceanWidth >= d.dims[1];
+}
+
+//the block of process rank inside a map of the whole ocean, as a single datatype
+inline MPI_Datatype blockType(const Decomposition &d, int rank, int stride) {
+	int firstRow, firstColumn, height, width;
+	blockOf(d, rank, firstRow, firstColumn, height, width);
+	MPI_Datatype type;
+	MPI_Type_vector(height, width, stride, MPI_CELL, &type);
+	MPI_Type_commit(&type);
+	return type;
+}
+
+//offset of the first cell of the block of process rank in a map of the whole ocean
+inline size_t blockOffset(const Decomposition &d, int rank, int stride) {
+	int firstRow, firstColumn, height, width;
+	blockOf(d, rank, firstRow, firstColumn, height, width);
+	return (size_t)firstRow * stride + firstColumn;
+}
+
+//process 0 sends every process its block of cells, the whole ocean row by row (only given on process 0)
+//the blocks are packed one after the other in the order of the ranks and sent with a single MPI_Scatterv,
+//every process receives its block straight into its map with the datatype of the block
+inline void scatterCells(const Decomposition &d, const cell_t *cells, Ocean<cell_t> &ocean) {
+	int nprocs;
+	MPI_Comm_size(d.comm, &nprocs);
+	std::vector<cell_t> packed;
+	std::vector<int> counts;
+	std::vector<int> displacements;
+	if (d.rank == 0) {
+		packed.resize((size_t)d.oceanHeight * d.oceanWidth);
+		counts.resize(nprocs);
+		displacements.resize(nprocs);
+		size_t offset = 0;
+		for (int r = 0; r < nprocs; r++) {
+			int firstRow, firstColumn, height, width;
+			blockOf(d, r, firstRow, firstColumn, height, width);
+			counts[r] = height * width;
+			displacements[r] = (int)offset;
+			for (int i = 0; i < height; i++) {
+				memcpy(&packed[offset], cells + (size_t)(firstRow - 1 + i) * d.oceanWidth + firstColumn - 1, width * sizeof(cell_t));
+				offset += width;
+			}
+		}
+	}
+	MPI_Datatype localType = blockType(d, d.rank, ocean.stride());
+	MPI_Scatterv(d.rank == 0 ? &packed[0] : NULL, d.rank == 0 ? &counts[0] : NULL, d.rank == 0 ? &displacements[0] : NULL, MPI_CELL,
+		ocean.oldRow(1) + 1, 1, localType, 0, d.comm);
+	MPI_Type_free(&localType);
+}
+
+//process 0 puts the block of every process back into whole, one message per process
+//with a codec every process compresses its block first and process 0 decompresses the blocks straight into whole,
+//returns false on process 0 when a compressed block could not be decompressed
+inline bool gatherOcean(const Decomposition &d, Ocean<cell_t> &ocean, Ocean<cell_t> *whole, BandCodec *codec = NULL) {
+	int nprocs;
+	MPI_Comm_size(d.comm, &nprocs);
+	if (codec != NULL) {
+		std::vector<uint8_t> packed;
+		codec->compress(ocean.oldRow(1) + 1, ocean.stride(), d.height, d.width, packed);
+		MPI_Request request;
+		MPI_Isend(&packed[0], (int)packed.size(), MPI_BYTE, 0, GATHER_TAG, d.comm, &request);
+		bool ok = true;
+		if (d.rank == 0) {
+			std::vector<uint8_t> received;
+			for (int r = 0; r < nprocs; r++) {
+				//the size of a compressed block is only known once it arrives
+				MPI_Status status;
+				int bytes;
+				MPI_Probe(r, GATHER_TAG, d.comm, &status);
+				MPI_Get_count(&status, MPI_BYTE, &bytes);
+				received.resize(bytes);
+				MPI_Recv(&received[0], bytes, MPI_BYTE, r, GATHER_TAG, d.comm, MPI_STATUS_IGNORE);
+				int firstRow, firstColumn, height, width;
+				blockOf(d, r, firstRow, firstColumn, height, width);
+				if (!codec->decompress(&received[0], received.size(), whole->oldRow(firstRow) + firstColumn, whole->stride(), height, width)) {
+					ok = false;
+				}
+			}
+		}
+		MPI_Wait(&request, MPI_STATUS_IGNORE);
+		return ok;
+	}
+	MPI_Datatype localType = blockType(d, d.rank, ocean.stride());
+	MPI_Request request;
+	MPI_Isend(ocean.oldRow(1) + 1, 1, localType, 0, GATHER_TAG, d.comm, &request);
+	if (d.rank == 0) {
+		for (int r = 0; r < nprocs; r++) {
+			MPI_Datatype type = blockType(d, r, whole->stride());
+			MPI_Recv(whole->oldRow(0) + blockOffset(d, r, whole->stride()), 1, type, r, GATHER_TAG, d.comm, MPI_STATUS_IGNORE);
+			MPI_Type_free(&type);
+		}
+	}
+	MPI_Wait(&request, MPI_STATUS_IGNORE);
+	MPI_Type_free(&localType);
+	return true;
+}
+
+//the deepest ring of extra cells every block can be given: a ring cannot be deeper than the smallest block
+//or it would need cells of the blocks beyond the neighbors
+//balanceBlocks never makes a block smaller than the ring, so this holds for the whole run
+inline int maxHalo(const Decomposition &d) {
+	int rows = d.oceanHeight / d.dims[0];
+	int columns = d.oceanWidth / d.dims[1];
+	return rows < columns ? rows : columns;
+}
+
+//moves the cuts of one dimension so that every part costs the same, cost[p] is what part p cost
+//the cost of a part is taken as spread evenly over its rows or columns, so a few moves get closer and closer
+//every part keeps at least minimum rows or columns
+inline void balanceCuts(std::vector<int> &cuts, const std::vector<double> &cost, int minimum) {
+	int parts = (int)cost.size();
+	int size = cuts[parts];
+	//cost of the first i rows or columns
+	std::vector<double> sum(size + 1);
+	sum[0] = 0;
+	for (int p = 0; p < parts; p++) {
+		double each = cost[p] / (cuts[p + 1] - cuts[p]);
+		for (int i = cuts[p]; i < cuts[p + 1]; i++) {
+			sum[i + 1] = sum[i] + each;
+		}
+	}
+	if (sum[size] <= 0) {
+		return;
+	}
+	int i = 0;
+	for (int p = 1; p < parts; p++) {
+		//the cut nearest to where p parts of the total cost end
+		double target = sum[size] * p / parts;
+		while (i < size && sum[i + 1] <= target) {
+			i++;
+		}
+		int cut = i < size && sum[i + 1] - target < target - sum[i] ? i + 1 : i;
+		if (cut < cuts[p - 1] + minimum) {
+			cut = cuts[p - 1] + minimum;
+		}
+		if (cut > size - (parts - p) * minimum) {
+			cut = size - (parts - p) * minimum;
+		}
+		cuts[p] = cut;
+	}
+}
+
+//moves the boundaries of the blocks so that every process takes as long to update its block, busy is how long this one took
+//the rows of the ocean are shared out again between the rows of blocks by what every row of blocks cost, and the columns the same way
+//returns false when the busiest process is within BALANCE_TOLERANCE of the mean, or when no cut moved
+inline bool balanceBlocks(Decomposition &d, double busy, int minimum) {
+	int nprocs;
+	MPI_Comm_size(d.comm, &nprocs);
+	std::vector<double> times(nprocs);
+	MPI_Allgather(&busy, 1, MPI_DOUBLE, &times[0], 1, MPI_DOUBLE, d.comm);
+	double total = 0;
+	double most = 0;
+	std::vector<double> rowCost(d.dims[0], 0.0);
+	std::vector<double> columnCost(d.dims[1], 0.0);
+	for (int r = 0; r < nprocs; r++) {
+		int coords[2];
+		MPI_Cart_coords(d.comm, r, 2, coords);
+		rowCost[coords[0]] += times[r];
+		columnCost[coords[1]] += times[r];
+		total += times[r];
+		most = times[r] > most ? times[r] : most;
+	}
+	if (most <= BALANCE_TOLERANCE * total / nprocs) {
+		return false;
+	}
+	//every process computes the same cuts from the same times
+	std::vector<int> rows = d.rowCuts;
+	std::vector<int> columns = d.columnCuts;
+	balanceCuts(d.rowCuts, rowCost, minimum);
+	balanceCuts(d.columnCuts, columnCost, minimum);
+	if (d.rowCuts == rows && d.columnCuts == columns) {
+		return false;
+	}
+	blockOf(d, d.rank, d.firstRow, d.firstColumn, d.height, d.width);
+	return true;
+}
+
+//the cells first..first+size-1 that are both in a..a+aSize-1 and in b..b+bSize-1, returns false when there are none
+inline bool overlap(int a, int aSize, int b, int bSize, int &first, int &size) {
+	first = a > b ? a : b;
+	int last = a + aSize < b + bSize ? a + aSize : b + bSize;
+	size = last - first;
+	return size > 0;
+}
+
+//moves the cells of the current map of from, laid out by the blocks of before, to the current map of to, laid out by the blocks of after
+//every process sends what it had of the new block of every other process, most of it goes to the neighbors when the cuts moved a little
+//the extra cells are not moved, the next exchange fills them
+inline void migrateCells(const Decomposition &before, const Decomposition &after, Ocean<cell_t> &from, Ocean<cell_t> &to) {
+	int nprocs;
+	MPI_Comm_size(after.comm, &nprocs);
+	std::vector<MPI_Request> requests;
+	for (int r = 0; r < nprocs; r++) {
+		int firstRow, firstColumn, height, width;
+		int i, j, rows, columns;
+		//what this process had of the new block of r
+		blockOf(after, r, firstRow, firstColumn, height, width);
+		if (overlap(before.firstRow, before.height, firstRow, height, i, rows) && overlap(before.firstColumn, before.width, firstColumn, width, j, columns)) {
+			MPI_Datatype type;
+			MPI_Type_vector(rows, columns, from.stride(), MPI_CELL, &type);
+			MPI_Type_commit(&type);
+			requests.push_back(MPI_REQUEST_NULL);
+			MPI_Isend(from.oldRow(i - before.firstRow + 1) + j - before.firstColumn + 1, 1, type, r, MIGRATE_TAG, after.comm, &requests.back());
+			//freeing the type does not affect the message that uses it
+			MPI_Type_free(&type);
+		}
+		//what r had of the new block of this process
+		blockOf(before, r, firstRow, firstColumn, height, width);
+		if (overlap(after.firstRow, after.height, firstRow, height, i, rows) && overlap(after.firstColumn, after.width, firstColumn, width, j, columns)) {
+			MPI_Datatype type;
+			MPI_Type_vector(rows, columns, to.stride(), MPI_CELL, &type);
+			MPI_Type_commit(&type);
+			requests.push_back(MPI_REQUEST_NULL);
+			MPI_Irecv(to.oldRow(i - after.firstRow + 1) + j - after.firstColumn + 1, 1, type, r, MIGRATE_TAG, after.comm, &requests.back());
+			MPI_Type_free(&type);
+		}
+	}
+	if (!requests.empty()) {
+		MPI_Waitall((int)requests.size(), &requests[0], MPI_STATUSES_IGNORE);
+	}
+}
+
+//the maps of the processes of a node, allocated in one MPI-3 shared window so the processes of the node
+//can copy the edges of each other's blocks straight from memory instead of sending them
+//every process gets its two maps (see the Ocean constructor that takes memory) and can find the maps of the others
+class SharedMaps {
+public:
+	SharedMaps(const Decomposition &decomposition, int halo) : d(decomposition), depth(halo) {
+		MPI_Comm_split_type(d.comm, MPI_COMM_TYPE_SHARED, d.rank, MPI_INFO_NULL, &node);
+		//OCEAN_ALIGNMENT more bytes so the maps can start on a cache line
+		//the window is mapped at page boundaries, so the start of a process's part has the same alignment in every process
+		MPI_Aint bytes = (MPI_Aint)(2 * Ocean<cell_t>::mapBytes(d.height, d.width, depth) + OCEAN_ALIGNMENT);
+		char *base;
+		MPI_Win_allocate_shared(bytes, 1, MPI_INFO_NULL, node, &base, &window);
+		MPI_Win_lock_all(MPI_MODE_NOCHECK, window);
+		own = aligned(base);
+
+		//the rank in node of every process of the grid, MPI_UNDEFINED for the processes of other nodes
+		int nprocs;
+		MPI_Comm_size(d.comm, &nprocs);
+		nodeRanks.resize(nprocs);
+		std::vector<int> ranks(nprocs);
+		for (int r = 0; r < nprocs; r++) {
+			ranks[r] = r;
+		}
+		MPI_Group grid, nodeGroup;
+		MPI_Comm_group(d.comm, &grid);
+		MPI_Comm_group(node, &nodeGroup);
+		MPI_Group_translate_ranks(grid, nprocs, &ranks[0], nodeGroup, &nodeRanks[0]);
+		MPI_Group_free(&grid);
+		MPI_Group_free(&nodeGroup);
+
+		//where the maps of the other processes of the node are in the memory of this process
+		bases.resize(nprocs);
+		for (int r = 0; r < nprocs; r++) {
+			bases[r] = NULL;
+			if (onNode(r)) {
+				MPI_Aint size;
+				int unit;
+				MPI_Win_shared_query(window, nodeRanks[r], &size, &unit, &bases[r]);
+				bases[r] = aligned(bases[r]);
+			}
+		}
+	}
+
+	~SharedMaps() {
+		MPI_Win_unlock_all(window);
+		MPI_Win_free(&window);
+		MPI_Comm_free(&node);
+	}
+
+	//the memory of the two maps of this process
+	void *memory() const { return own; }
+
+	//true when process rank of the grid is on this node
+	bool onNode(int rank) const { return nodeRanks[rank] != MPI_UNDEFINED; }
+
+	//cell (i, j) of map buffer (0 or 1, see Ocean::current) of process rank, which has to be on this node
+	//the maps of the other process are laid out as in Ocean, from the size of its block
+	const cell_t *cell(int rank, int buffer, int i, int j) const {
+		int firstRow, firstColumn, height, width;
+		blockOf(d, rank, firstRow, firstColumn, height, width);
+		int stride = Ocean<cell_t>::strideFor(width, depth);
+		const cell_t *map = (const cell_t *)(bases[rank] + buffer * Ocean<cell_t>::mapBytes(height, width, depth));
+		return map + Ocean<cell_t>::originFor(stride, depth) + (ptrdiff_t)i * stride + j;
+	}
+
+	//every process of the node has written its maps before the others read them, and has read them before they are written again
+	void sync() {
+		MPI_Win_sync(window);
+		MPI_Barrier(node);
+		MPI_Win_sync(window);
+	}
+
+private:
+	SharedMaps(const SharedMaps &);
+	SharedMaps &operator=(const SharedMaps &);
+
+	static char *aligned(char *base) {
+		return base + (OCEAN_ALIGNMENT - (size_t)base % OCEAN_ALIGNMENT) % OCEAN_ALIGNMENT;
+	}
+
+	const Decomposition &d;
+	int depth;
+	MPI_Comm node;
+	MPI_Win window;
+	char *own;
+	std::vector<int> nodeRanks;
+	std::vector<char *> bases;
+};
+
+//tags of the partitioned messages of the first and last rows, a message going in direction d has the tag PARTITION_TAG + d
+#define PARTITION_TAG 4100
+
+//the cells of the edges and of the corners of a block as MPI datatypes, so every halo goes as a single message
+//8 messages per exchange: the 4 edges and the 4 corners, the corners are needed by the diagonal neighbors
+//the edges are as deep as the ring of extra cells of the ocean, halo rows or columns
+//the peers, buffers and sizes never change, so the messages of both maps are set up once as persistent requests
+//and every exchange only starts the ones of the current map
+//with shared maps, the edges of the neighbors on the same node are copied from their maps and only the others are sent
+//with partitioned messages (MPI-4), the first and last rows go as one partition per row, and every row is sent
+//as soon as the thread that computed it marks it ready (see startRows and rowReady)
+class HaloExchange {
+public:
+	HaloExchange(const Decomposition &decomposition, Ocean<cell_t> &ocean, SharedMaps *sharedMaps = NULL, bool partitionedRows = false)
+		: d(decomposition), stride(ocean.stride()), depth(ocean.halo()), shared(sharedMaps), partitioned(partitionedRows) {
+		//the rows of an edge are contiguous, a column edge is depth cells every stride cells
+		MPI_Type_vector(depth, d.width, stride, MPI_CELL, &rowType);
+		MPI_Type_commit(&rowType);
+		MPI_Type_vector(d.height, depth, stride, MPI_CELL, &columnType);
+		MPI_Type_commit(&columnType);
+		MPI_Type_vector(depth, depth, stride, MPI_CELL, &cornerType);
+		MPI_Type_commit(&cornerType);
+#if MPI_VERSION >= 4
+		//a partition is one row of the block, its extent is a whole row of the map so the partitions follow each other
+		MPI_Datatype row;
+		MPI_Type_contiguous(d.width, MPI_CELL, &row);
+		MPI_Type_create_resized(row, 0, (MPI_Aint)stride * sizeof(cell_t), &partitionType);
+		MPI_Type_commit(&partitionType);
+		MPI_Type_free(&row);
+#endif
+
+		for (int b = 0; b < 2; b++) {
+			cell_t *base = b == ocean.current() ? ocean.oldRow(0) : ocean.newRow(0);
+			maps[b] = base;
+			requestCount[b] = 0;
+#if MPI_VERSION >= 4
+			for (int r = 0; r < 4; r++) {
+				rowRequests[b][r] = MPI_REQUEST_NULL;
+			}
+#endif
+			for (int k = 0; k < DIRECTIONS; k++) {
+				if (shared != NULL && shared->onNode(d.neighbor[k])) {
+					continue;
+				}
+#if MPI_VERSION >= 4
+				if (partitioned && directionColumn[k] == 0) {
+					//the message from the neighbor in direction k is the one it sent in the opposite direction
+					MPI_Precv_init(base + haloOffset(k), depth, 1, partitionType, d.neighbor[k], PARTITION_TAG + (k ^ 1), d.comm, MPI_INFO_NULL, &rowRequests[b][k]);
+					MPI_Psend_init(base + edgeOffset(k), depth, 1, partitionType, d.neighbor[k], PARTITION_TAG + k, d.comm, MPI_INFO_NULL, &rowRequests[b][2 + k]);
+					continue;
+				}
+#endif
+				//the message from the neighbor in direction k is the one it sent in the opposite direction
+				MPI_Recv_init(base + haloOffset(k), 1, type(k), d.neighbor[k], HALO_TAG + (k ^ 1), d.comm, &requests[b][requestCount[b]++]);
+				MPI_Send_init(base + edgeOffset(k), 1, type(k), d.neighbor[k], HALO_TAG + k, d.comm, &requests[b][requestCount[b]++]);
+			}
+		}
+	}
+
+	~HaloExchange() {
+		for (int b = 0; b < 2; b++) {
+			for (int r = 0; r < requestCount[b]; r++) {
+				MPI_Request_free(&requests[b][r]);
+			}
+#if MPI_VERSION >= 4
+			for (int r = 0; r < 4; r++) {
+				if (rowRequests[b][r] != MPI_REQUEST_NULL) {
+					MPI_Request_free(&rowRequests[b][r]);
+				}
+			}
+#endif
+		}
+#if MPI_VERSION >= 4
+		MPI_Type_free(&partitionType);
+#endif
+		MPI_Type_free(&rowType);
+		MPI_Type_free(&columnType);
+		MPI_Type_free(&cornerType);
+	}
+
+	//fills the extra rows and columns of the current map with the edges of the neighboring blocks
+	void exchange(Ocean<cell_t> &ocean) {
+		start(ocean);
+		finish();
+	}
+
+	//starts the exchange and returns right away, the cells of the block that are not on its edges can be updated meanwhile
+	//the extra cells must not be read and the edges must not be written until finish returns
+	//with partitioned rows, the rows of the current map must have been started by startRows before it was computed
+	void start(Ocean<cell_t> &ocean) {
+		buffer = ocean.current();
+		MPI_Startall(requestCount[buffer], requests[buffer]);
+	}
+
+	//copies the edges of the neighbors on the same node and waits for the messages started by start
+	void finish() {
+		if (shared != NULL) {
+			//every process of the node takes part in the syncs, even without a neighbor on the node
+			shared->sync();
+			for (int k = 0; k < DIRECTIONS; k++) {
+				if (shared->onNode(d.neighbor[k])) {
+					copyEdge(k);
+				}
+			}
+			shared->sync();
+		}
+		MPI_Waitall(requestCount[buffer], requests[buffer], MPI_STATUSES_IGNORE);
+#if MPI_VERSION >= 4
+		if (partitioned) {
+			MPI_Waitall(4, rowRequests[buffer], MPI_STATUSES_IGNORE);
+		}
+#endif
+	}
+
+	//true when the first and last rows go as partitioned messages
+	bool partitionedRows() const { return partitioned; }
+
+	//starts the partitioned messages of the first and last rows of map buffer (0 or 1, see Ocean::current),
+	//before the generation that writes that map is computed, every row then has to be marked by rowReady
+	void startRows(int b) {
+#if MPI_VERSION >= 4
+		//the rows of the neighbors on the same node are copied from shared memory, they have no request
+		for (int r = 0; r < 4; r++) {
+			if (rowRequests[b][r] != MPI_REQUEST_NULL) {
+				MPI_Start(&rowRequests[b][r]);
+			}
+		}
+#else
+		(void)b;
+#endif
+	}
+
+	//row i of map buffer b is written, it leaves right away if it is one of the first or last rows
+	//can be called by any thread, which needs MPI_THREAD_MULTIPLE
+	void rowReady(int b, int i) {
+#if MPI_VERSION >= 4
+		//a block smaller than two rings has rows that are in both edges
+		if (i >= 1 && i <= depth && rowRequests[b][2 + NORTH] != MPI_REQUEST_NULL) {
+			MPI_Pready(i - 1, rowRequests[b][2 + NORTH]);
+		}
+		if (i >= d.height - depth + 1 && i <= d.height && rowRequests[b][2 + SOUTH] != MPI_REQUEST_NULL) {
+			MPI_Pready(i - (d.height - depth + 1), rowRequests[b][2 + SOUTH]);
+		}
+#else
+		(void)b;
+		(void)i;
+#endif
+	}
+
+	//all the rows of map buffer b are written, for a map that was not computed by a generation
+	void allRowsReady(int b) {
+		for (int i = 1; i <= d.height; i++) {
+			rowReady(b, i);
+		}
+	}
+
+private:
+	HaloExchange(const HaloExchange &);
+	HaloExchange &operator=(const HaloExchange &);
+
+	MPI_Datatype type(int k) const {
+		return directionColumn[k] == 0 ? rowType : directionRow[k] == 0 ? columnType : cornerType;
+	}
+
+	//first cell of the block that goes to the neighbor in direction k: the last depth rows or columns on that side
+	ptrdiff_t edgeOffset(int k) const {
+		int i = directionRow[k] > 0 ? d.height - depth + 1 : 1;
+		int j = directionColumn[k] > 0 ? d.width - depth + 1 : 1;
+		return (ptrdiff_t)i * stride + j;
+	}
+
+	//copies the edge of the neighbor in direction k into the extra cells, the same cells a message would bring
+	//all the processes swap their maps every generation, so the current map of the neighbor is the same buffer as ours
+	void copyEdge(int k) {
+		int firstRow, firstColumn, height, width;
+		blockOf(d, d.neighbor[k], firstRow, firstColumn, height, width);
+		int rows = directionRow[k] == 0 ? d.height : depth;
+		int columns = directionColumn[k] == 0 ? d.width : depth;
+		//the edge of the neighbor facing this block: its last rows or columns when it is above or to the left
+		int i = directionRow[k] < 0 ? height - depth + 1 : 1;
+		int j = directionColumn[k] < 0 ? width - depth + 1 : 1;
+		cell_t *to = maps[buffer] + haloOffset(k);
+		const cell_t *from = shared->cell(d.neighbor[k], buffer, i, j);
+		int fromStride = Ocean<cell_t>::strideFor(width, depth);
+		for (int r = 0; r < rows; r++) {
+			memcpy(to + (ptrdiff_t)r * stride, from + (ptrdiff_t)r * fromStride, columns * sizeof(cell_t));
+		}
+	}
+
+	//first extra cell that receives the edge of the neighbor in direction k
+	ptrdiff_t haloOffset(int k) const {
+		int i = directionRow[k] < 0 ? 1 - depth : directionRow[k] > 0 ? d.height + 1 : 1;
+		int j = directionColumn[k] < 0 ? 1 - depth : directionColumn[k] > 0 ? d.width + 1 : 1;
+		return (ptrdiff_t)i * stride + j;
+	}
+
+	const Decomposition &d;
+	int stride;
+	int depth;
+	SharedMaps *shared;
+	bool partitioned;
+	//cell (0, 0) of both maps, and the buffer of the current map between start and finish
+	cell_t *maps[2];
+	int buffer;
+	MPI_Datatype rowType;
+	MPI_Datatype columnType;
+	MPI_Datatype cornerType;
+	//the persistent requests of both maps, a receive and a send per direction that is not copied from shared memory
+	MPI_Request requests[2][2 * DIRECTIONS];
+	int requestCount[2];
+#if MPI_VERSION >= 4
+	MPI_Datatype partitionType;
+	//the partitioned receives from the north and south neighbors, then the sends to them
+	MPI_Request rowRequests[2][4];
+#endif
+};
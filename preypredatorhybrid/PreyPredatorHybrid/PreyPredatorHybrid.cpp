@@ -1,540 +1,853 @@
-// PreyPredatorMPI.cpp : main project file.
-// Defines the entry point for the console application.
-
-#include "stdafx.h"
-#include <stdio.h>
-#include <stdlib.h>
-#include <math.h> 
-#include <iostream>
-#include <omp.h>
-#include <time.h> 
-#include <array>
-#include <mpi.h>
-using namespace std;
-
-//speed selected will display every nth generation (1,10 or 100)
-#define FAST 100
-#define MEDIUM 10
-#define SLOW 1
-
-//array dimensions
-#define HEIGHT 1024
-#define WIDTH 2048  //does not have to be a multiple of the number of processes, however processes have to be even
-
-//total number of steps to be done
-#define NUMBER_OF_STEPS 500
-
-//global map with 2 extra rows and 2 extra columns to deal with boundaries
-int oldMap[HEIGHT + 2][WIDTH + 2] = { 0 };
-
-int newMap[HEIGHT + 2][WIDTH + 2];
-
-//processes and threads say hello when created
-bool polite = true;
-
-//only set to true on small oceans
-bool display = false;
-
-//ages all the fish and sharks, kills the ones that should die, and spawns the ones that live
-//all changes are stored in newMap and then copied into oldMap
-void update(int myID, int nprocs);
-
-//displays the whole grid to the console
-void print();
-//returns the number of fish and sharks as a pair (fish, shark) in the whole ocean
-pair<int, int> countOceanMembers(int myID, int nprocs, int myThreadID);
-
-//obsolete method
-pair<int, int> analyze();
-//returns the number of fish and sharks as a pair (fish, shark) for the current process
-pair<int, int> analyzeCurrentProcess(int myID, int nprocs);
-//returns the number of neighboring fish and sharks and specifies how many are adults  of a given cell
-//where i and j specify the location of that cell
-//the returned format will be in an array of four numbers:
-//number of all neighboring fish, number of adult neighboring fish, number of all neighboring sharks, number of adult neighboring sharks)
-//array<int, 4>  neighborCount(int i, int j);
-void evaluate(int value, int &fish, int &adultFish, int &sharks, int &adultSharks);
-
-int main(int argc, char *argv[])
-{
-	/* initialize MPI */
-	//nprocs will hold the number of processes there are, and myID will hold this process's current ID
-	int nprocs, myID;
-
-	MPI_Init(&argc, &argv);
-	MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
-	MPI_Comm_rank(MPI_COMM_WORLD, &myID);
-	MPI_Status status;
-
-	if(polite)
-		cout << "hello i am process: " << myID+1 << " out of " << nprocs << endl;
-	fflush(stdout);
-
-	clock_t t1, t2;
-	t1 = clock();
-	//setting the speed
-	int speed = FAST;
-
-
-	//only the first process needs to initialize the ocean/world
-	int i, j = 0;
-	float randFloat;
-	if (myID == 0)
-	{
-		//initializing the array with 50% fish, 25% sharks, and 25% empty cells
-		//note that the borders (2 rows and 2 columns) are left empty as they will be overwritten next
-		for (i = 1; i <= HEIGHT; i++) {
-			for (j = 1; j <= WIDTH; j++) {
-				randFloat = rand() / ((float)RAND_MAX + 1);
-				if (randFloat < 0.25) {
-					//25% are empty
-					oldMap[i][j] = 0;
-				}
-				else if (randFloat >= 0.25 && randFloat < 0.5) {
-					//25% are sharks
-					oldMap[i][j] = -1;
-				}
-				else {
-					//50% are fish
-					oldMap[i][j] = 1;
-				}
-				//******optional for testing
-				//oldMap[i][j] = (i*WIDTH + j)%10;
-				//end of optional code
-
-			}
-		}
-	}
-	//now the first process has to send the 2D array to the other processes
-	if (myID == 0) {
-		//send
-		//send the portion of the map to the correct process by dividing the grid evenly along the width
-		//this for loop goes from 1 to number of processes-1 and sends data to each process
-		for (int destinationProcess = 1; destinationProcess < nprocs; destinationProcess++) {
-			//going through all the i's for every process
-			for (i = 1; i <= HEIGHT; i++) {
-				//each process should only take 1/nprocs of the width
-				for (int k = ((destinationProcess*WIDTH / nprocs) + 1); k <= WIDTH*(destinationProcess + 1) / nprocs; k++) {
-					MPI_Send(&oldMap[i][k], 1, MPI_INT, destinationProcess, k, MPI_COMM_WORLD); //the tag is k
-				}
-			}
-		}
-	}
-	else {
-		//receive 
-		for (i = 1; i <= HEIGHT; i++) {
-			//each process should only take 1/nprocs of the width
-			for (int k = ((myID*WIDTH / nprocs) + 1); k <= WIDTH*(myID + 1) / nprocs; k++) {
-				MPI_Recv(&oldMap[i][k], 1, MPI_INT, 0, k, MPI_COMM_WORLD, &status); //the tag is k
-			}
-		}
-
-	}
-
-	//code snippet to test that changing the data on other processes is working properly
-	/*	if (myID!=0) {
-	for (i = 1; i <= HEIGHT; i++) {
-	for (j = 1; j <= WIDTH; j++) {
-	oldMap[i][j]--;
-	if (oldMap[i][j] < 0) { oldMap[i][j] = 9; }
-	}
-	}
-	}
-	*/
-
-	//to repeat the simulation NUMBER_OF_STEPS of times
-	for (int n = 0; n <= NUMBER_OF_STEPS; n++) {
-
-		//firstly each process needs to send its last column to the process on its right(modulo nprocs)
-		//and send its first column to the process on its left (with process 0 sending to process nprocs-1)
-		//simultaneously each process needs to receive its neighboring columns
-		for (i = 1; i <= HEIGHT; i++) {
-			int right, left;
-			right = (myID + 1) % nprocs;
-			left = (myID + nprocs - 1) % nprocs; //adding nprocs to eliminate the chance of getting negative process ID
-			if (myID % 2 == 0) { //even numbered process
-								 //sending the last column to the process on the right (next ID)
-				MPI_Send(&oldMap[i][WIDTH*(right) / nprocs], 1, MPI_INT, right, 021, MPI_COMM_WORLD); //the tag says 0 to 1, ie even to next odd
-																									  //receiving from the previous process and placing it before the leftmost column
-				MPI_Recv(&oldMap[i][(myID*WIDTH / nprocs)], 1, MPI_INT, left, 122, MPI_COMM_WORLD, &status); //the tag says zero to 1, ie odd to next even
-
-																											 //sending the first column to the process on the left (myID-1)
-				MPI_Send(&oldMap[i][(WIDTH*myID / nprocs) + 1], 1, MPI_INT, left, 221, MPI_COMM_WORLD); //the tag says two to 1
-
-																										//receiving from the process on the right
-				MPI_Recv(&oldMap[i][((myID + 1)*WIDTH / nprocs) + 1], 1, MPI_INT, right, 120, MPI_COMM_WORLD, &status); //the tag says 1 to zero
-
-			}
-			else { //odd numbered process
-				   //receiving from the previous process and placing it on the left column
-				MPI_Recv(&oldMap[i][(myID*WIDTH / nprocs)], 1, MPI_INT, left, 021, MPI_COMM_WORLD, &status); //the tag says zero to 1
-																											 //sending the last column to the process on the right (next ID)
-				MPI_Send(&oldMap[i][WIDTH*(myID + 1) / nprocs], 1, MPI_INT, right, 122, MPI_COMM_WORLD); //the tag says one to two
-
-																										 //receiving the first column of the right process and placing it after this process's last column
-				MPI_Recv(&oldMap[i][((myID + 1)*WIDTH / nprocs) + 1], 1, MPI_INT, right, 221, MPI_COMM_WORLD, &status); //the tag says zero to 1
-																														//sending the first column to the left
-				MPI_Send(&oldMap[i][(WIDTH*myID / nprocs) + 1], 1, MPI_INT, left, 120, MPI_COMM_WORLD); //the tag says 1 to zero
-		}
-		}
-		//now each thread needs to fill in it's top and bottom extra rows
-		//with the extra column included (since the corner cells will require these neighbors)
-		//so we subtract 1 from the initial value of j and add 1 to the final value
-
-		// top-bottom boundary conditions
-		for (j = (myID*WIDTH / nprocs); j <= (myID + 1)*WIDTH / nprocs + 1; j++) {
-			oldMap[0][j] = oldMap[HEIGHT][j]; //the row before the first is the last
-			oldMap[HEIGHT + 1][j] = oldMap[1][j]; //the row after the last is the first
-		}
-
-		//print();
-		//going through the entire 2D array and updating it
-		//note that here each process does its own part only and not the entire WIDTHxHEIGHT grid
-		//update(myID, nprocs);
-		
-		//****** replacing update *****
-		//for OpenMP to work, the threads shouldnt perform function calls, that is why I'm moving the update code here:
-		int numOfThreads = 4;
-#pragma omp parallel num_threads(numOfThreads)
-		{
-			//firstly, let the threads say hello
-			if (n == 1 && polite) {
-				int tid;
-				tid = omp_get_thread_num();
-				printf("hi, from cpu %d of %d. I am thread %d of %d\n", myID+1,nprocs, tid+1,numOfThreads);
-				fflush(stdout);
-			}
-#pragma omp for schedule(guided,1)
-			for (int i = 1; i <= HEIGHT; i++) {
-				
-				for (int j = (myID*WIDTH / nprocs) + 1; j <= (myID + 1)*WIDTH / nprocs; j++) {
-					//for each cell we count how many neighbors it has
-					//array<int, 4> neighborsArr = neighborCount(i, j);
-					//replacing neighborCount by its code
-
-					//nFish is the number of neighboring fish, nAdultFish is the number of neighboring adult fish
-					//nSharks is the number of neighboring sharks, nAdultSharks is the number of neighboring adult sharks
-					int nFish, nAdultFish, nSharks, nAdultSharks = 0;
-
-					//to ensure that the function is not given a boundary cell
-					if (i <= 0 || j <= 0 || (i >= HEIGHT + 1) || (j >= WIDTH + 1)) {
-						cout << "passed an invalid cell to neighborCount" << endl;
-						//return NULL;
-					}
-					int iMinus, iPlus, jMinus, jPlus;
-					iMinus = i - 1;
-					iPlus = i + 1;
-					jMinus = j - 1;
-					jPlus = j + 1;
-
-					//1  2  3
-					//4  X  5
-					//6  7  8
-					//got rid of all the evaluate function calls, and replaced them with:
-					//this way when we implement everything in main, no clashes occur between threads of the same process
-					array<int, 8> cellNeighbors = { oldMap[iMinus][jMinus], oldMap[i][jMinus], oldMap[iPlus][jMinus] //neighbors 1,2,3
-						, oldMap[iMinus][j] , oldMap[iPlus][j]   // neighbors 4 and 5
-						, oldMap[iMinus][jPlus], oldMap[i][jPlus] , oldMap[iPlus][jPlus] }; // neighbors 6,7,8
-
-					for (int neighborsCounter = 0; neighborsCounter < 8; neighborsCounter++) {
-						//replacing the evaluate function:
-						if (cellNeighbors[neighborsCounter] == 0) { //empty cell
-							continue;
-						}
-						else
-							if (cellNeighbors[neighborsCounter] > 0) { // fish
-								nFish++;
-								if (cellNeighbors[neighborsCounter] >= 2) { // adult fish
-									nAdultFish++;
-								}
-							}
-							else
-								if (cellNeighbors[neighborsCounter] < 0) { //shark
-									nSharks++;
-									if (cellNeighbors[neighborsCounter] <= -3) { //adult shark
-										nAdultSharks++;
-									}
-								}
-					}
-
-					if (oldMap[i][j] > 0) { //fish
-											//implementing all the fish rules
-											//a fish can die by being eaten, overpopulation, or old age
-						if (nSharks >= 5 || nFish == 8 || oldMap[i][j] == 10) {
-							newMap[i][j] = 0; //fish dies 
-						}
-						else {
-							//the fish survived, we increment its age
-							newMap[i][j] = oldMap[i][j] + 1;
-						}
-					}
-					else if (oldMap[i][j] < 0) { //shark
-												 //implementing all the shark rules
-						float sharkHeartAttack;
-						sharkHeartAttack = rand() / ((float)RAND_MAX + 1);
-						//a shark can die by either starvation or randomly or because of old age
-						if ((nSharks >= 6 && nFish == 0) || (sharkHeartAttack <= 0.031) || (oldMap[i][j] <= -20)) {
-							newMap[i][j] = 0; //shark dies
-						}
-						else {
-							//shark survives, increment age by making the cell's value more negative
-							newMap[i][j] = oldMap[i][j] - 1;
-						}
-					}
-					else { //empty
-						   //breeding rules
-						if (nFish >= 4 && nAdultFish >= 3 && nSharks < 4) {
-							newMap[i][j] = 1; //a fish is born
-						}
-						else if (nSharks >= 4 && nAdultSharks >= 3 && nFish < 4) {
-							newMap[i][j] = -1; //a shark is born
-						}
-						else {
-							//nothing is born
-							newMap[i][j] = oldMap[i][j]; //or set it to 0 (since this cell was empty and will remain empty)
-						}
-					}
-					//****optional code for testing only
-					//oldMap[i][j] = myID;
-					//end of optional testing code
-
-					//resetting the numbers back to get ready for the next cell
-					nFish = 0;
-					nAdultFish = 0;
-					nSharks = 0;
-					nAdultSharks = 0;
-				}
-			}
-		}
-		//now we copy the new map into the old map
-		for (i = 1; i <= HEIGHT; i++) {
-			for (j = (myID*WIDTH / nprocs) + 1; j <= (myID + 1)*WIDTH / nprocs; j++) {
-				oldMap[i][j] = newMap[i][j];
-			}
-		}
-
-		//if we're in a multiple of speed, let process 0 thread 0 display the current fish and shark count
-		if (n%speed == 0) {
-			countOceanMembers(myID, nprocs, 0); //TODO tid
-			if (myID == 0)
-			{
-				cout << "in generation " << n << endl;
-				//in order to count the fish and the sharks correctly in between frames, we'll need to merge the total of each process
-				//cout << "There are: " << countOceanMembers(0, nprocs).first << " fish and " << countOceanMembers(0, nprocs).second << " sharks" << endl;
-				//bug found in above line. Deadlock being created: basically thread 0 is going in and waiting to receive nothing
-				//so i'll have to call countOceanMembers with all other threads so that they send it their info.
-
-
-				//cout << "there are: " << analyze().first << " fish and " << analyze().second << " sharks" << endl;
-				if (display) {
-					print();
-				}
-			}
-		}
-	}
-
-	if (myID == 0) {
-		//when all the time steps are complete
-		t2 = clock();
-
-		//displaying the ascii visualization is only viable when width and height are small enough
-		//print();
-		
-		float diff((float)t2 - (float)t1);
-		cout << "Parallel processing using hybrid(OpenMP+MPI) of a " << WIDTH << "x" << HEIGHT << " grid. Performing " << NUMBER_OF_STEPS << " iterations." << endl;
-		printf("Processing time %f seconds using %d processes \n", (diff / 1000), nprocs);
-
-	}
-	countOceanMembers(myID, nprocs,0);
-	fflush(stdout);
-
-	MPI_Finalize();
-	//system("pause");
-	return 0;
-}
-
-void print() {
-	for (int i = 1; i < HEIGHT + 1; i++) {
-		for (int j = 1; j < WIDTH + 1; j++) {
-			//cout << " ";
-			if (oldMap[i][j] > 0) {
-				cout << "f";// << oldMap[i][j];
-			}
-			else if (oldMap[i][j] < 0) {
-				cout << "s";
-			}
-			else {
-				cout << "-";
-			}
-			//cout << " ";
-		}
-		cout << endl;
-	}
-	cout << endl;
-
-	//**** optional for testing
-	/*for (int i = 0; i < HEIGHT + 2; i++) { //TODO: from 1 to height +1  to not display boundaries
-	for (int j = 0; j < WIDTH + 2; j++) {
-	cout << oldMap[i][j];
-	}
-	cout << endl;
-	}*/
-	//end of optional code
-}
-
-pair<int, int> analyze() {
-	int numOfFish = 0;
-	int numOfSharks = 0;
-	for (int i = 1; i <= HEIGHT; i++) {
-		for (int j = 1; j <= WIDTH; j++) {
-			if (oldMap[i][j] < 0) {
-				numOfSharks++;
-			}
-			if (oldMap[i][j] > 0) {
-				numOfFish++;
-			}
-		}
-	}
-	return pair<int, int>(numOfFish, numOfSharks);
-}
-
-pair<int, int> analyzeCurrentProcess(int myID, int nprocs) {
-	int numOfSharks = 0;
-	int numOfFish = 0;
-	for (int i = 1; i <= HEIGHT; i++) {
-		//each process should only analyze its subsection
-		for (int k = ((myID*WIDTH / nprocs) + 1); k <= WIDTH*(myID + 1) / nprocs; k++) {
-			if(oldMap[i][k]>0){
-				numOfFish++;
-				//cout << "+" << endl;
-			}
-			if (oldMap[i][k] < 0) {
-				numOfSharks++;
-				//cout << "-" << endl;
-			}
-			
-		}
-	}
-	//for debugging only
-	//cout << "in process " << myID << " there are " << numOfFish << " fish and " << numOfSharks << " sharks" << endl;
-	return pair<int, int>(numOfFish, numOfSharks);
-}
-
-//array<int, 4> neighborCount(int i, int j) {
-	//code moved to main
-//}
-
-pair<int, int> countOceanMembers(int myID, int nprocs, int myThreadID) {
-	int totalFish = 0;
-	int totalSharks = 0;
-	MPI_Request request;
-	MPI_Status status;
-	//this block only works on small enough values of HEIGHT and WIDTH, when they grow too big, we run out of memory
-	//that is why I will implement a different technique for counting total fish and sharks
-	/*
-	//all the processes send back their parts of the ocean to process 0
-	if (myID == 0) {
-	//this for loop goes from 1 to number of processes-1 and receives data from every process
-	for (int sourceProcess = 1; sourceProcess < nprocs; sourceProcess++) {
-	//going through all the i's for every process
-	for (i = 1; i <= HEIGHT; i++) {
-	//each process should only take 1/nprocs of the width
-	for (int k = ((sourceProcess*WIDTH / nprocs) + 1); k <= WIDTH*(sourceProcess + 1) / nprocs; k++) {
-	//receive from all the other processes
-	MPI_Recv(&oldMap[i][k], 1, MPI_INT, sourceProcess, 123, MPI_COMM_WORLD, &status);
-	}
-	}
-	}
-	}
-	else {
-	//send to process 0 the final ocean
-	for (i = 1; i <= HEIGHT; i++) {
-	//each process should only send 1/nprocs of the width
-	for (int k = ((myID*WIDTH / nprocs) + 1); k <= WIDTH*(myID + 1) / nprocs; k++) {
-	MPI_Send(&oldMap[i][k], 1, MPI_INT, 0, 123, MPI_COMM_WORLD);
-	}
-	}
-	}
-	*/
-
-	//the alternative way is to let each process count its fish and sharks, and send only the totals to process 0
-	if (myID == 0) {
-		int tempReceiverFish = 0;
-		int tempReceiverSharks = 0;
-		totalFish = analyzeCurrentProcess(0, nprocs).first;
-		totalSharks = analyzeCurrentProcess(0, nprocs).second;
-		
-		//receiving all the sums of fish and sharks
-		for (int sourceProcess = 1; sourceProcess < nprocs; sourceProcess++)
-		{
-			//the receives need to be nonblocking to prevent from deadlocks
-			MPI_Irecv(&tempReceiverFish, 1, MPI_INT, sourceProcess, 32120, MPI_COMM_WORLD, &request);
-			//asking all the other processes for their total fish and shark counts
-			//countOceanMembers(sourceProcess, nprocs); //this line prevents deadlock
-
-			MPI_Wait(&request, &status);
-			totalFish += tempReceiverFish;
-			//cout << "received " << tempReceiverFish << " fish" << endl;
-			MPI_Irecv(&tempReceiverSharks, 1, MPI_INT, sourceProcess, 12320, MPI_COMM_WORLD, &request);
-
-			MPI_Wait(&request, &status);
-			//cout << "received " << tempReceiverSharks << " sharks" << endl;
-			totalSharks += tempReceiverSharks;
-
-			//cout<<"THE NEW TOTALS ARE "<<totalFish<<"   "<<totalSharks<<endl;
-			//receive fishcounts from all the other processes
-			//MPI_Recv(&tempReceiverFish, 1, MPI_INT, sourceProcess, 32120, MPI_COMM_WORLD, &status);
-			//totalFish += tempReceiverFish;
-			//receive sharkcounts from all the other processes
-			//MPI_Recv(&tempReceiverSharks, 1, MPI_INT, sourceProcess, 12320, MPI_COMM_WORLD, &status);
-			//totalSharks += tempReceiverSharks;
-
-		}
-		if (myThreadID == 0) {
-			cout << "There are: " << totalFish << " fish and " << totalSharks << " sharks" << endl;
-		}
-	}
-	else {
-		int fishCount = 0;
-		int sharkCount = 0;
-		//send to process 0 the total number of fish and sharks in this subsection of the ocean
-		fishCount = analyzeCurrentProcess(myID, nprocs).first;
-		sharkCount = analyzeCurrentProcess(myID, nprocs).second;
-		//nonblocking sending of the number of fish in this process
-		//MPI_Isend(&fishCount, 1, MPI_INT, 0, 32120, MPI_COMM_WORLD, &request);
-		//MPI_Wait(&request, &status);
-		//nonblocking sending of number of sharks in this process
-		//MPI_Isend(&sharkCount, 1, MPI_INT, 0, 12320, MPI_COMM_WORLD, &request);
-		//MPI_Wait(&request, &status);
-		//
-		MPI_Send(&fishCount, 1, MPI_INT, 0, 32120, MPI_COMM_WORLD);
-		//cout << "sent " << fishCount << " fish" << endl;
-		MPI_Send(&sharkCount, 1, MPI_INT, 0, 12320, MPI_COMM_WORLD);
-		//cout << "sent " << sharkCount << " sharks" << endl;
-	}
-
-	return pair<int, int>(totalFish, totalSharks);
-}
-
-void evaluate(int value, int &fish, int &adultFish, int &sharks, int &adultSharks) {
-	//cout << "value: " << value << " fish: " << fish << " aFish: " << adultFish << " sharks: " << sharks << endl;
-	if (value == 0) { //empty cell
-		return;
-	}
-	if (value > 0) { // fish
-		fish++;
-		if (value >= 2) { // adult fish
-			adultFish++;
-		}
-	}
-	if (value < 0) { //shark
-		sharks++;
-		if (value <= -3) { //adult shark
-			adultSharks++;
-		}
-	}
-}
-
-void update(int myID, int nprocs) {
-	//code moved to main
+// PreyPredatorMPI.cpp : main project file.
+// Defines the entry point for the console application.
+
+#include "stdafx.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h> 
+#include <iostream>
+#include <omp.h>
+#include <time.h> 
+#include <array>
+#include <vector>
+#include <mpi.h>
+#include "../../common/Ocean.h"
+#include "../../common/Options.h"
+#include "../../common/Kernel.h"
+#include "../../common/Random.h"
+#include "../../common/Stats.h"
+#include "../../common/Series.h"
+#include "../../common/Snapshot.h"
+#include "../../common/DensityPyramid.h"
+#include "../../common/FrameChannel.h"
+#include "Decomposition.h"
+#include "StatsReduction.h"
+#include "Checkpoint.h"
+using namespace std;
+
+//speed selected will display every nth generation (1,10 or 100)
+#define FAST 100
+#define MEDIUM 10
+#define SLOW 1
+
+//default array dimensions, can be changed at runtime with --height= and --width=
+#define HEIGHT 1024
+#define WIDTH 2048  //does not have to be a multiple of the number of processes, any number of processes works
+
+//default total number of steps to be done, can be changed at runtime with --steps=
+#define NUMBER_OF_STEPS 500
+
+//default seed of the random numbers, can be changed at runtime with --seed=
+//the same seed gives the same ocean whatever the number of threads or processes
+#define SEED 1
+
+//default depth of the ring of extra cells of every block, can be changed at runtime with --halo=
+//with a ring k cells deep the processes exchange their edges once every k generations instead of every generation
+#define HALO_DEPTH 1
+
+//default number of generations between two rebalancings of the blocks, can be changed at runtime with --balance=, 0 never moves them
+#define BALANCE_INTERVAL 100
+
+//default number of generations between two checkpoints with --checkpoint=, can be changed at runtime with --checkpoints=
+#define CHECKPOINT_INTERVAL 100
+
+//default number of generations between two snapshots with --snapshot=, can be changed at runtime with --snapshots=
+#define SNAPSHOT_INTERVAL 100
+
+//processes and threads say hello when created
+bool polite = true;
+
+//only set to true on small oceans
+bool display = false;
+
+//ages all the fish and sharks, kills the ones that should die, and spawns the ones that live
+//all changes are stored in newMap, which then becomes the current map by swapping the two buffers
+void update(int myID, int nprocs);
+
+//applies the rules to cells first..last of row i of the block (see Kernel.h), and counts them into stats
+//i, first and last can be in the ring of extra cells, those cells are computed but not counted
+//when density is not NULL the cells of the block are also counted into its tiles (see DensityPyramid.h)
+void updateCells(Ocean<cell_t> &ocean, RowKernel<cell_t>::Function kernel, const Decomposition &block, uint32_t seed, int generation,
+	int i, int first, int last, bool ages, DensityPyramid *density, OceanStats &stats);
+
+//moves the boundaries of the blocks when some processes took longer than the others to update their cells (see balanceBlocks),
+//busy is how long this process took since the last time, the cells are sent to the processes that own them in the new blocks
+//and the maps and the halo messages are made again for the new size of the block, returns false when nothing moved
+bool rebalance(Decomposition &block, double busy, int halo, SharedMaps *&shared, Ocean<cell_t> *&maps, HaloExchange *&halos, bool partitioned);
+
+//reads the starting ocean from path: height*width signed bytes, row by row, each one the value of a cell
+//returns false when the file cannot be read, is not exactly that size, or holds a value that is not a cell
+bool readCells(const char *path, int height, int width, vector<cell_t> &cells);
+
+//displays the whole grid to the console
+void print(Ocean<cell_t> &ocean);
+//returns the number of fish and sharks as a pair (fish, shark) in the whole ocean
+//stats holds what the kernels counted in the part of the ocean of this process, process 0 of comm adds up all of them and displays them
+pair<int, int> countOceanMembers(OceanStats &stats, MPI_Comm comm, int myID, int myThreadID);
+//adds up the stats of all the processes of comm into total on its process 0, the other processes only send theirs
+void gatherStats(const OceanStats &stats, OceanStats &total, MPI_Comm comm);
+//waits for the totals of the generation started in reduction, process 0 writes them to the series and displays them every speed generations
+//with the map of view at level when view is not NULL
+void reportStats(StatsReduction &reduction, SeriesWriter &series, bool ages, int speed, Ocean<cell_t> *whole, const DensityPyramid *view, int level, int myID);
+//displays the totals of all the processes
+void displayStats(const OceanStats &total);
+
+//obsolete method
+pair<int, int> analyze(Ocean<cell_t> &ocean);
+//obsolete since the kernels count the fish and sharks while updating the ocean
+//returns the number of fish and sharks as a pair (fish, shark) for the current process
+pair<int, int> analyzeCurrentProcess(Ocean<cell_t> &ocean, int myID, int nprocs);
+//counting the neighbors and applying the rules is done by the kernel (see Kernel.h)
+
+int main(int argc, char *argv[])
+{
+	/* initialize MPI */
+	//nprocs will hold the number of processes there are, and myID will hold this process's current ID
+	int nprocs, myID;
+
+	//the threads of a process never call MPI themselves, only the master thread does
+	//except with --exchange=partitioned, where every thread marks the rows it computed as ready to be sent
+	bool partitioned = optionIs(argc, argv, "exchange", "partitioned");
+	int required = partitioned ? MPI_THREAD_MULTIPLE : MPI_THREAD_FUNNELED;
+	int provided;
+	MPI_Init_thread(&argc, &argv, required, &provided);
+	MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+	MPI_Comm_rank(MPI_COMM_WORLD, &myID);
+
+	if(polite)
+		cout << "hello i am process: " << myID+1 << " out of " << nprocs << endl;
+	if (provided < MPI_THREAD_FUNNELED && myID == 0)
+		cout << "warning: the MPI library does not support MPI_THREAD_FUNNELED" << endl;
+	fflush(stdout);
+#if MPI_VERSION < 4
+	//partitioned messages are from MPI-4
+	if (partitioned) {
+		if (myID == 0) {
+			printf("--exchange=partitioned needs an MPI-4 library\n");
+		}
+		MPI_Finalize();
+		return 1;
+	}
+#endif
+	if (partitioned && provided < MPI_THREAD_MULTIPLE) {
+		if (myID == 0) {
+			printf("--exchange=partitioned needs MPI_THREAD_MULTIPLE\n");
+		}
+		MPI_Finalize();
+		return 1;
+	}
+
+	clock_t t1, t2;
+	t1 = clock();
+	//setting the speed, --speed=1 displays the statistics of every generation
+	int speed = intOption(argc, argv, "speed", FAST);
+	if (speed < 1) {
+		if (myID == 0) {
+			printf("--speed has to be at least 1\n");
+		}
+		MPI_Finalize();
+		return 1;
+	}
+
+	int height = intOption(argc, argv, "height", HEIGHT);
+	int width = intOption(argc, argv, "width", WIDTH);
+	int numberOfSteps = intOption(argc, argv, "steps", NUMBER_OF_STEPS);
+	uint32_t seed = (uint32_t)intOption(argc, argv, "seed", SEED);
+	int halo = intOption(argc, argv, "halo", HALO_DEPTH);
+	int balance = intOption(argc, argv, "balance", BALANCE_INTERVAL);
+	//checked before the ocean is split between the processes
+	if (height < 1 || width < 1 || numberOfSteps < 1) {
+		if (myID == 0) {
+			printf("--height, --width and --steps have to be at least 1\n");
+		}
+		MPI_Finalize();
+		return 1;
+	}
+	//the first generation to compute, a restarted run goes on from the generation of its checkpoint
+	int first = 0;
+
+	//--restart=file goes on from a checkpoint written by --checkpoint= (see Checkpoint.h), with any number of processes
+	//the size of the ocean, the seed and the generation are the ones of the checkpoint
+	const char *restartPath = optionValue(argc, argv, "restart");
+	if (restartPath != NULL) {
+		CheckpointHeader header;
+		if (!readCheckpointHeader(restartPath, MPI_COMM_WORLD, header) || header.generation < 0 || header.generation > INT_MAX) {
+			if (myID == 0) {
+				printf("%s is not a checkpoint\n", restartPath);
+			}
+			MPI_Finalize();
+			return 1;
+		}
+		height = (int)header.height;
+		width = (int)header.width;
+		seed = (uint32_t)header.seed;
+		first = (int)header.generation;
+	}
+
+	//the processes form a 2D grid and every process keeps only its block of the ocean (see Decomposition.h)
+	//with halo extra rows and columns on every side that receive the edges of the neighboring blocks
+	Decomposition block = decompose(height, width, nprocs);
+	if (!validDecomposition(block)) {
+		if (myID == 0) {
+			printf("a %dx%d ocean cannot be split into %dx%d blocks\n", height, width, block.dims[0], block.dims[1]);
+		}
+		MPI_Finalize();
+		return 1;
+	}
+	if (halo < 1 || halo > maxHalo(block)) {
+		if (myID == 0) {
+			printf("the halo has to be between 1 and %d cells deep with %dx%d blocks\n", maxHalo(block), block.dims[0], block.dims[1]);
+		}
+		MPI_Finalize();
+		return 1;
+	}
+	//the AVX2 kernel is used when the processor supports it, unless --kernel=scalar is given
+	//--rules= picks one of the rule sets compiled into the program (see Rules.h)
+	const char *rules = optionValue(argc, argv, "rules");
+	if (rules == NULL) {
+		rules = DEFAULT_RULES;
+	}
+	RowKernel<cell_t>::Function kernel = selectRowKernel<cell_t>(optionIs(argc, argv, "kernel", "scalar"), rules);
+	if (kernel == NULL) {
+		if (myID == 0) {
+			printf("unknown rules %s, the rules are:", rules);
+			printRuleNames();
+		}
+		MPI_Finalize();
+		return 1;
+	}
+
+	//--series=file writes the statistics and age histograms of every generation to file, as CSV or binary when it ends in .bin
+	//every process counts the ages of its part of the ocean, only process 0 writes the file
+	SeriesWriter series;
+	const char *seriesPath = optionValue(argc, argv, "series");
+	bool ages = seriesPath != NULL;
+	if (myID == 0 && ages && !series.open(seriesPath)) {
+		printf("cannot create %s\n", seriesPath);
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+
+	//--snapshot=file saves the ocean to file every --snapshots= generations and after the last one, as a snapshot of the serial
+	//and OpenMP versions that they can go on from with --restart= (see Snapshot.h), the blocks are gathered to process 0
+	//and a background thread of process 0 writes them
+	//--compress=k has k threads of every process compress its block before it is sent, and the snapshot before it is written (see BandCodec.h)
+	SnapshotWriter snapshots;
+	const char *snapshotPath = optionValue(argc, argv, "snapshot");
+	int snapshotInterval = intOption(argc, argv, "snapshots", SNAPSHOT_INTERVAL);
+	int compressThreads = intOption(argc, argv, "compress", 0);
+	BandCodec codec(compressThreads);
+	if (myID == 0 && snapshotPath != NULL) {
+		snapshots.start(snapshotPath, compressThreads);
+	}
+
+	//--view=columns displays a map of the ocean at most columns characters wide with the statistics
+	//every process counts the tiles of its block while the displayed generations are computed (see DensityPyramid.h),
+	//and only the level of the map is added up on process 0, a few kilobytes whatever the size of the ocean
+	int viewColumns = intOption(argc, argv, "view", 0);
+	DensityPyramid *density = NULL;
+	DensityPyramid *view = NULL;
+	int viewLevel = 0;
+	if (viewColumns > 0) {
+		density = new DensityPyramid(height, width);
+		density->setArea(block.firstRow, block.firstColumn, block.height, block.width);
+		viewLevel = density->levelFor(viewColumns);
+		if (myID == 0) {
+			view = new DensityPyramid(height, width, viewLevel);
+		}
+	}
+	//--publish=name hands every displayed generation to a viewer through the shared memory called name (see FrameChannel.h),
+	//the tiles of the map with --view= and otherwise all the cells gathered to process 0, the simulation never waits for the viewer
+	FramePublisher publisher;
+	const char *publishName = optionValue(argc, argv, "publish");
+	bool publishCells = publishName != NULL && viewColumns <= 0;
+	if (myID == 0 && publishName != NULL) {
+		size_t capacity = view != NULL ? sizeof(DensityTile) * view->tileRows(viewLevel) * view->tileColumns(viewLevel) : (size_t)height * width;
+		if (!publisher.open(publishName, capacity)) {
+			printf("cannot create the shared memory %s\n", publishName);
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+	}
+
+	//the map of the whole ocean is only kept by process 0 to display it, to save it or to publish it
+	Ocean<cell_t> *whole = NULL;
+	if (myID == 0 && (display || snapshotPath != NULL || publishCells)) {
+		whole = new Ocean<cell_t>(height, width);
+	}
+	//--threads= sets the number of threads of every process, by default the OpenMP default (OMP_NUM_THREADS or the number of cores)
+	int numOfThreads = intOption(argc, argv, "threads", omp_get_max_threads());
+	if (numOfThreads < 1) {
+		numOfThreads = 1;
+	}
+
+	//--initial=file starts from the cells of file (see readCells), process 0 reads it and sends every process its block
+	const char *initialPath = optionValue(argc, argv, "initial");
+	vector<cell_t> cells;
+	if (initialPath != NULL && restartPath != NULL) {
+		if (myID == 0) {
+			printf("--initial and --restart cannot be used together\n");
+		}
+		delete whole;
+		delete density;
+		delete view;
+		MPI_Comm_free(&block.comm);
+		MPI_Finalize();
+		return 1;
+	}
+	if (initialPath != NULL) {
+		int loaded = 1;
+		if (myID == 0 && !readCells(initialPath, height, width, cells)) {
+			printf("cannot read the %dx%d cells of %s\n", height, width, initialPath);
+			loaded = 0;
+		}
+		MPI_Bcast(&loaded, 1, MPI_INT, 0, block.comm);
+		if (!loaded) {
+			delete whole;
+			delete density;
+			delete view;
+			MPI_Comm_free(&block.comm);
+			MPI_Finalize();
+			return 1;
+		}
+	}
+
+	//--exchange=shared puts the maps of the processes of a node in a shared window (see SharedMaps in Decomposition.h),
+	//the processes of a node then copy each other's edges from memory and only the edges of the blocks of other nodes are sent
+	SharedMaps *shared = NULL;
+	if (optionIs(argc, argv, "exchange", "shared")) {
+		shared = new SharedMaps(block, halo);
+	}
+	//Ocean<cell_t> ocean(height, width);
+	Ocean<cell_t> *maps = shared != NULL ? new Ocean<cell_t>(block.height, block.width, halo, shared->memory())
+		: new Ocean<cell_t>(block.height, block.width, halo);
+
+	if (restartPath != NULL) {
+		//every process reads its own block of the file
+		if (!readCheckpoint(restartPath, block, *maps)) {
+			if (myID == 0) {
+				printf("cannot read the cells of %s, or it holds a value that is not a cell\n", restartPath);
+			}
+			MPI_Abort(block.comm, 1);
+		}
+	}
+	else if (initialPath != NULL) {
+		scatterCells(block, myID == 0 ? &cells[0] : NULL, *maps);
+		vector<cell_t>().swap(cells);
+	}
+	else {
+		//every process draws its own block and every thread its own rows, nothing is sent
+		//the random numbers depend only on the position of the cell in the whole ocean, so this is the same ocean as in the serial version
+		//initializing the array with 50% fish, 25% sharks, and 25% empty cells
+		//note that the borders are left empty as they will be overwritten next
+#pragma omp parallel for num_threads(numOfThreads)
+		for (int i = 1; i <= block.height; i++) {
+			cell_t *row = maps->oldRow(i);
+			for (int j = 1; j <= block.width; j++) {
+				row[j] = initialCell<cell_t>(seed, block.firstRow + i - 1, block.firstColumn + j - 1);
+				//******optional for testing
+				//row[j] = (i*width + j)%10;
+				//end of optional code
+			}
+		}
+	}
+	//the datatypes of the halos are freed before MPI_Finalize
+	//the halo messages are set up once as persistent requests
+	HaloExchange *halos = new HaloExchange(block, *maps, shared, partitioned);
+
+	//code snippet to test that changing the data on other processes is working properly
+	/*	if (myID!=0) {
+	for (i = 1; i <= height; i++) {
+	for (j = 1; j <= width; j++) {
+	ocean.oldRow(i)[j]--;
+	if (ocean.oldRow(i)[j] < 0) { ocean.oldRow(i)[j] = 9; }
+	}
+	}
+	}
+	*/
+
+	//what the last generation did to the part of the ocean of this process, counted by the kernels
+	OceanStats stats;
+	stats.clear();
+	//the threads add their counts into counting during the generation
+	OceanStats counting;
+	counting.clear();
+	StatsReduction reduction(block.comm);
+	//how long the threads of this process spent updating cells since the blocks were last balanced, and over the whole run
+	double busy = 0;
+	double totalBusy = 0;
+	int balanced = first;
+	//--checkpoint=file saves the ocean to file every --checkpoints= generations and after the last one, for --restart=
+	const char *checkpointPath = optionValue(argc, argv, "checkpoint");
+	int checkpoints = intOption(argc, argv, "checkpoints", CHECKPOINT_INTERVAL);
+	//with partitioned rows, the first and last rows of a generation that is sent are started before it is computed
+	//the starting ocean is sent by the first generation as it is, and the first generation is itself sent with a ring of 1:
+	//the edges are exchanged every halo generations from the first one, so the second generation exchanges them only when halo is 1,
+	//and then the rows of the first generation have to be started before it is computed, like the loop does for the later ones
+	if (partitioned) {
+		halos->startRows(maps->current());
+		halos->allRowsReady(maps->current());
+		if (halo == 1 && first + 1 <= numberOfSteps) {
+			halos->startRows(1 - maps->current());
+		}
+	}
+	//the threads are created once for the whole run, every thread goes through all the generations
+	//only the master thread calls MPI (MPI_THREAD_FUNNELED), the other threads wait for it at barriers
+#pragma omp parallel num_threads(numOfThreads)
+	{
+		//every thread counts its own rows, the counts are added together at the end of every generation
+		OceanStats threadStats;
+		//and times its own rows
+		double threadBusy;
+		//to repeat the simulation numberOfSteps of times
+		for (int n = first; n <= numberOfSteps; n++) {
+			threadStats.clear();
+			threadBusy = 0;
+			//the cells are only counted into the tiles in the generations that are displayed
+			DensityPyramid *counted = n%speed == 0 ? density : NULL;
+			//the maps are made again when the blocks are rebalanced
+			Ocean<cell_t> &ocean = *maps;
+
+			//firstly each process needs to receive the edges of its 8 neighboring blocks into its extra rows and columns
+			//the 4 edges and the 4 corners go as 8 messages, whatever the size of the block (see Decomposition.h)
+			//with a deeper ring this only happens every halo generations: in between, every process also computes
+			//the extra cells that the next generations need, and the ring of valid extra cells shrinks by one cell per generation
+			//the generations are counted from the first one, whose extra cells are always empty
+			bool exchange = (n - first) % halo == 0;
+			int margin = halo - 1 - (n - first) % halo;
+
+			//firstly, let the threads say hello
+			if (n == first + 1 && polite) {
+				int tid;
+				tid = omp_get_thread_num();
+				printf("hi, from cpu %d of %d. I am thread %d of %d\n", myID+1,nprocs, tid+1,numOfThreads);
+				fflush(stdout);
+			}
+
+			//print();
+			//going through the entire 2D array and updating it
+			//note that here each process does its own part only and not the entire WIDTHxHEIGHT grid
+			//update(myID, nprocs);
+			if (exchange) {
+				//the master thread starts the messages and waits for them, meanwhile the other threads update the inside of the block,
+				//rows 2 to height-1 and columns 2 to width-1, which does not read any extra cell
+				//the master thread joins them when the messages have arrived and takes what is left of the inside
+#pragma omp master
+				{
+					halos->start(ocean);
+					halos->finish();
+				}
+#pragma omp for schedule(dynamic,1) nowait
+				for (int i = 2; i <= block.height - 1; i++) {
+					double started = omp_get_wtime();
+					updateCells(ocean, kernel, block, seed, n, i, 2, block.width - 1, ages, counted, threadStats);
+					threadBusy += omp_get_wtime() - started;
+				}
+#pragma omp barrier
+			}
+			//then the rest: the edges of the block, the first and last rows and the first and last cells of the rows in between,
+			//and the margin extra cells around them that are still needed by the next generations
+			//the generation before an exchange sends each of its first and last rows as soon as it is finished
+			bool sendRows = partitioned && (n + 1 - first) % halo == 0 && n + 1 <= numberOfSteps;
+#pragma omp for schedule(guided,1)
+			for (int i = 1 - margin; i <= block.height + margin; i++) {
+				double started = omp_get_wtime();
+				if (exchange && i >= 2 && i <= block.height - 1 && block.width >= 3) {
+					updateCells(ocean, kernel, block, seed, n, i, 1 - margin, 1, ages, counted, threadStats);
+					updateCells(ocean, kernel, block, seed, n, i, block.width, block.width + margin, ages, counted, threadStats);
+				}
+				else {
+					updateCells(ocean, kernel, block, seed, n, i, 1 - margin, block.width + margin, ages, counted, threadStats);
+				}
+				threadBusy += omp_get_wtime() - started;
+				if (sendRows) {
+					halos->rowReady(1 - ocean.current(), i);
+				}
+			}
+#pragma omp critical
+			{
+				counting.add(threadStats);
+				busy += threadBusy;
+				totalBusy += threadBusy;
+			}
+#pragma omp barrier
+
+#pragma omp master
+			{
+				//the new map becomes the current one, no copying needed
+				ocean.swap();
+				//--balance=k moves the boundaries of the blocks every k generations, if some processes were busier than the others
+				//only before a generation that exchanges the edges, which fills the extra cells of the new blocks
+				//the tiles counted in this generation still belong to the old block, the new one is counted from the next display on
+				bool moved = false;
+				if (balance > 0 && n - balanced >= balance && (n + 1 - first) % halo == 0 && n + 1 <= numberOfSteps) {
+					moved = rebalance(block, busy, halo, shared, maps, halos, partitioned);
+					busy = 0;
+					balanced = n;
+				}
+				//the rows of the next generation are started if it is sent, the barrier below keeps the threads from marking them before
+				if (partitioned && (n + 2 - first) % halo == 0 && n + 2 <= numberOfSteps) {
+					halos->startRows(1 - maps->current());
+				}
+				//every process writes its block of the checkpoint at once, the next generation to compute is n + 1
+				if (checkpointPath != NULL && ((checkpoints > 0 && (n + 1) % checkpoints == 0) || n == numberOfSteps)) {
+					if (!writeCheckpoint(checkpointPath, block, *maps, n + 1, seed) && myID == 0) {
+						printf("cannot write the checkpoint %s\n", checkpointPath);
+					}
+				}
+				//the totals of the previous generation were summed while this one was computed (see StatsReduction.h)
+				//process 0 queues them to the writer thread, and displays them if we're in a multiple of speed
+				if (reduction.pending()) {
+					reportStats(reduction, series, ages, speed, whole, view, viewLevel, myID);
+				}
+				//gathered after the map of the previous generation was displayed, it reuses the same whole ocean
+				//the compressing threads run while the other threads of the process wait at the barrier below
+				if (snapshotPath != NULL && ((snapshotInterval > 0 && (n + 1) % snapshotInterval == 0) || n == numberOfSteps)) {
+					if (!gatherOcean(block, *maps, whole, compressThreads > 0 ? &codec : NULL)) {
+						printf("cannot decompress the blocks of generation %d\n", n + 1);
+					}
+					else if (myID == 0) {
+						snapshots.capture(*whole, n + 1, seed);
+					}
+				}
+
+				stats = counting;
+				counting.clear();
+				if (ages || n%speed == 0) {
+					reduction.start(stats, n);
+				}
+				//the ocean is gathered right away, it is displayed with the totals of this generation
+				if (n%speed == 0 && (display || publishCells)) {
+					gatherOcean(block, *maps, whole);
+					if (publisher.isOpen()) {
+						publisher.publishCells(*whole, n);
+					}
+				}
+				//and so is the map, after the one of the previous generation was displayed
+				if (density != NULL) {
+					if (n%speed == 0) {
+						density->build();
+						MPI_Reduce(density->level(viewLevel), view != NULL ? view->level(viewLevel) : NULL,
+							2 * density->tileRows(viewLevel) * density->tileColumns(viewLevel), MPI_UINT32_T, MPI_SUM, 0, block.comm);
+						if (view != NULL) {
+							view->fillAbove(viewLevel);
+							if (publisher.isOpen()) {
+								publisher.publishDensity(*view, viewLevel, n);
+							}
+						}
+					}
+					if (moved) {
+						density->setArea(block.firstRow, block.firstColumn, block.height, block.width);
+					}
+				}
+			}
+			//no thread starts the next generation before the buffers are swapped
+#pragma omp barrier
+		}
+	}
+	if (reduction.pending()) {
+		reportStats(reduction, series, ages, speed, whole, view, viewLevel, myID);
+	}
+
+	//the time the busiest process spent updating its cells and the mean, the closer they are the better the blocks were balanced
+	double busiest, allBusy;
+	MPI_Reduce(&totalBusy, &busiest, 1, MPI_DOUBLE, MPI_MAX, 0, block.comm);
+	MPI_Reduce(&totalBusy, &allBusy, 1, MPI_DOUBLE, MPI_SUM, 0, block.comm);
+
+	if (myID == 0) {
+		//when all the time steps are complete
+		t2 = clock();
+		//the records still queued are written after the clock is stopped
+		series.close();
+		snapshots.close();
+		if (snapshots.droppedSnapshots() > 0 || snapshots.failedSnapshots() > 0) {
+			printf("%d snapshots were replaced by newer ones before they were written, %d could not be written\n",
+				snapshots.droppedSnapshots(), snapshots.failedSnapshots());
+		}
+		if (compressThreads > 0 && snapshots.rawCellBytes() > 0) {
+			printf("the snapshots took %.1f%% of the size of their cells\n", 100.0 * snapshots.storedCellBytes() / snapshots.rawCellBytes());
+		}
+		if (publisher.isOpen()) {
+			publisher.close();
+			printf("%llu frames were replaced by newer ones before the viewer took them\n", (unsigned long long)publisher.droppedFrames());
+		}
+
+		//displaying the ascii visualization is only viable when width and height are small enough
+		//print(ocean);
+		
+		float diff((float)t2 - (float)t1);
+		cout << "Parallel processing using hybrid(OpenMP+MPI) of a " << width << "x" << height << " grid. Performing " << numberOfSteps << " iterations." << endl;
+		printf("Processing time %f seconds using %d processes \n", (diff / 1000), nprocs);
+		cout << "using the " << rowKernelName<cell_t>(kernel) << " kernel with the " << rules << " rules" << endl;
+		printf("updating the cells took %f seconds on the busiest process and %f seconds on average\n", busiest, allBusy / nprocs);
+
+	}
+	countOceanMembers(stats, block.comm, myID, 0);
+	fflush(stdout);
+
+	delete whole;
+	delete density;
+	delete view;
+	delete halos;
+	delete maps;
+	delete shared;
+	MPI_Comm_free(&block.comm);
+	MPI_Finalize();
+	//system("pause");
+	return 0;
+}
+
+void updateCells(Ocean<cell_t> &ocean, RowKernel<cell_t>::Function kernel, const Decomposition &block, uint32_t seed, int generation,
+	int i, int first, int last, bool ages, DensityPyramid *density, OceanStats &stats) {
+	const cell_t *above = ocean.oldRow(i - 1);
+	const cell_t *here = ocean.oldRow(i);
+	const cell_t *below = ocean.oldRow(i + 1);
+	cell_t *newRow = ocean.newRow(i);
+	//the random numbers are the ones of the same cells in the whole ocean, so an extra cell computed here
+	//gets exactly the value the process it belongs to computes, the extra cells of the blocks on the sides of the ocean wrap around
+	int row = block.firstRow + i - 1;
+	row = row < 1 ? row + block.oceanHeight : row > block.oceanHeight ? row - block.oceanHeight : row;
+	RowRandom random = rowRandom(seed, generation, row, block.firstColumn - 1);
+	//the extra cells are counted by the process they belong to
+	OceanStats extra;
+	extra.clear();
+	bool own = i >= 1 && i <= block.height;
+	if (first < 1) {
+		RowRandom left = random;
+		if (block.firstColumn == 1) {
+			left.columnOffset += block.oceanWidth;
+		}
+		kernel(above, here, below, newRow, first, last < 0 ? last : 0, left, extra);
+	}
+	int from = first > 1 ? first : 1;
+	int to = last < block.width ? last : block.width;
+	if (from <= to) {
+		kernel(above, here, below, newRow, from, to, random, own ? stats : extra);
+		//the ages are counted while the new row is still in the cache
+		if (ages && own) {
+			countAges(newRow, from, to, stats);
+		}
+		//the rows of a block are shared out between the threads, and the inside of a row is finished before its edges are computed
+		if (density != NULL && own) {
+			density->countCells(i, newRow, from, to);
+		}
+	}
+	if (last > block.width) {
+		RowRandom right = random;
+		if (block.firstColumn + block.width - 1 == block.oceanWidth) {
+			right.columnOffset -= block.oceanWidth;
+		}
+		kernel(above, here, below, newRow, first > block.width + 1 ? first : block.width + 1, last, right, extra);
+	}
+}
+
+bool rebalance(Decomposition &block, double busy, int halo, SharedMaps *&shared, Ocean<cell_t> *&maps, HaloExchange *&halos, bool partitioned) {
+	Decomposition before = block;
+	//no block gets smaller than the ring of extra cells
+	if (!balanceBlocks(block, busy, halo)) {
+		return false;
+	}
+	//the first and last rows of the current map were already marked ready, they are received into the old maps before these go
+	if (partitioned) {
+		halos->exchange(*maps);
+	}
+	delete halos;
+	SharedMaps *newShared = NULL;
+	if (shared != NULL) {
+		newShared = new SharedMaps(block, halo);
+	}
+	Ocean<cell_t> *newMaps = newShared != NULL ? new Ocean<cell_t>(block.height, block.width, halo, newShared->memory())
+		: new Ocean<cell_t>(block.height, block.width, halo);
+	migrateCells(before, block, *maps, *newMaps);
+	delete maps;
+	delete shared;
+	maps = newMaps;
+	shared = newShared;
+	halos = new HaloExchange(block, *maps, shared, partitioned);
+	//the new current map was not computed by a generation, its rows are all ready at once
+	if (partitioned) {
+		halos->startRows(maps->current());
+		halos->allRowsReady(maps->current());
+	}
+	return true;
+}
+
+bool readCells(const char *path, int height, int width, vector<cell_t> &cells) {
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		return false;
+	}
+	size_t count = (size_t)height * width;
+	vector<int8_t> bytes(count + 1);
+	//one more byte is asked for to find out if the file is too long
+	size_t read = fread(&bytes[0], 1, count + 1, file);
+	fclose(file);
+	if (read != count) {
+		return false;
+	}
+	cells.resize(count);
+	for (size_t k = 0; k < count; k++) {
+		if (bytes[k] < -SHARK_AGES || bytes[k] > FISH_AGES) {
+			return false;
+		}
+		cells[k] = (cell_t)bytes[k];
+	}
+	return true;
+}
+
+void print(Ocean<cell_t> &ocean) {
+	for (int i = 1; i < ocean.height() + 1; i++) {
+		const cell_t *row = ocean.oldRow(i);
+		for (int j = 1; j < ocean.width() + 1; j++) {
+			//cout << " ";
+			if (row[j] > 0) {
+				cout << "f";// << row[j];
+			}
+			else if (row[j] < 0) {
+				cout << "s";
+			}
+			else {
+				cout << "-";
+			}
+			//cout << " ";
+		}
+		cout << endl;
+	}
+	cout << endl;
+
+	//**** optional for testing
+	/*for (int i = 0; i < ocean.height() + 2; i++) { //TODO: from 1 to height +1  to not display boundaries
+	for (int j = 0; j < ocean.width() + 2; j++) {
+	cout << ocean.oldRow(i)[j];
+	}
+	cout << endl;
+	}*/
+	//end of optional code
+}
+
+pair<int, int> analyze(Ocean<cell_t> &ocean) {
+	int numOfFish = 0;
+	int numOfSharks = 0;
+	for (int i = 1; i <= ocean.height(); i++) {
+		const cell_t *row = ocean.oldRow(i);
+		for (int j = 1; j <= ocean.width(); j++) {
+			if (row[j] < 0) {
+				numOfSharks++;
+			}
+			if (row[j] > 0) {
+				numOfFish++;
+			}
+		}
+	}
+	return pair<int, int>(numOfFish, numOfSharks);
+}
+
+pair<int, int> analyzeCurrentProcess(Ocean<cell_t> &ocean, int myID, int nprocs) {
+	int numOfSharks = 0;
+	int numOfFish = 0;
+	int width = ocean.width();
+	for (int i = 1; i <= ocean.height(); i++) {
+		const cell_t *row = ocean.oldRow(i);
+		//each process should only analyze its subsection
+		for (int k = ((myID*width / nprocs) + 1); k <= width*(myID + 1) / nprocs; k++) {
+			if(row[k]>0){
+				numOfFish++;
+				//cout << "+" << endl;
+			}
+			if (row[k] < 0) {
+				numOfSharks++;
+				//cout << "-" << endl;
+			}
+			
+		}
+	}
+	//for debugging only
+	//cout << "in process " << myID << " there are " << numOfFish << " fish and " << numOfSharks << " sharks" << endl;
+	return pair<int, int>(numOfFish, numOfSharks);
+}
+
+//array<int, 4> neighborCount(int i, int j) {
+	//code moved to main
+//}
+
+pair<int, int> countOceanMembers(OceanStats &stats, MPI_Comm comm, int myID, int myThreadID) {
+	int totalFish = 0;
+	int totalSharks = 0;
+	//this block only works on small enough values of height and width, when they grow too big, we run out of memory
+	//that is why I will implement a different technique for counting total fish and sharks
+	/*
+	//all the processes send back their parts of the ocean to process 0
+	if (myID == 0) {
+	//this for loop goes from 1 to number of processes-1 and receives data from every process
+	for (int sourceProcess = 1; sourceProcess < nprocs; sourceProcess++) {
+	//going through all the i's for every process
+	for (i = 1; i <= ocean.height(); i++) {
+	//each process should only take 1/nprocs of the width
+	for (int k = ((sourceProcess*ocean.width() / nprocs) + 1); k <= ocean.width()*(sourceProcess + 1) / nprocs; k++) {
+	//receive from all the other processes
+	MPI_Recv(&ocean.oldRow(i)[k], 1, MPI_CELL, sourceProcess, 123, MPI_COMM_WORLD, &status);
+	}
+	}
+	}
+	}
+	else {
+	//send to process 0 the final ocean
+	for (i = 1; i <= ocean.height(); i++) {
+	//each process should only send 1/nprocs of the width
+	for (int k = ((myID*ocean.width() / nprocs) + 1); k <= ocean.width()*(myID + 1) / nprocs; k++) {
+	MPI_Send(&ocean.oldRow(i)[k], 1, MPI_CELL, 0, 123, MPI_COMM_WORLD);
+	}
+	}
+	}
+	*/
+
+	//the alternative way is to let each process count its fish and sharks, and send only the totals to process 0
+	OceanStats total;
+	gatherStats(stats, total, comm);
+	if (myID == 0) {
+		totalFish = (int)total.fish;
+		totalSharks = (int)total.sharks;
+		if (myThreadID == 0) {
+			displayStats(total);
+		}
+	}
+
+	return pair<int, int>(totalFish, totalSharks);
+}
+
+void gatherStats(const OceanStats &stats, OceanStats &total, MPI_Comm comm) {
+	//the kernels already counted them during the update, so every process adds its whole OceanStats as an array of integers
+	//a single collective instead of process 0 receiving from every process in turn, over the grid of the blocks like the other collectives
+	MPI_Reduce(&stats, &total, OCEAN_STATS_FIELDS, MPI_INT64_T, MPI_SUM, 0, comm);
+}
+
+void reportStats(StatsReduction &reduction, SeriesWriter &series, bool ages, int speed, Ocean<cell_t> *whole, const DensityPyramid *view, int level, int myID) {
+	OceanStats total;
+	int generation = reduction.finish(total);
+	if (myID != 0) {
+		return;
+	}
+	if (ages) {
+		series.write(generation, total);
+	}
+	if (generation%speed == 0) {
+		displayStats(total);
+		cout << "in generation " << generation << endl;
+		//cout << "there are: " << analyze(ocean).first << " fish and " << analyze(ocean).second << " sharks" << endl;
+		if (display) {
+			print(*whole);
+		}
+		if (view != NULL) {
+			printDensity(*view, level);
+		}
+	}
+}
+
+void displayStats(const OceanStats &total) {
+	cout << "There are: " << total.fish << " fish and " << total.sharks << " sharks" << endl;
+	printStats(total);
+}
+
+void update(int myID, int nprocs) {
+	//code moved to main
 }
\ No newline at end of file
@@ -0,0 +1,53 @@
+// StatsReduction.h : adds up the statistics of all the processes on process 0 with a collective reduction
+// the sum of a generation is started right after the generation is computed and only waited for after the next one,
+// so it travels while the processes compute instead of process 0 receiving from every process in turn
+
+#pragma once
+
+#include <mpi.h>
+#include "../../common/Stats.h"
+
+//every field of OceanStats is a 64 bit integer, so the struct is summed as an array of OCEAN_STATS_FIELDS of them
+class StatsReduction {
+public:
+	StatsReduction(MPI_Comm communicator) : comm(communicator), active(false), generation(0) {}
+
+	//starts adding up the stats of generation, they are copied so the caller can clear them right away
+	//MPI_Ireduce is from MPI-3, with an older MPI the sum is done here with the blocking MPI_Reduce
+	void start(const OceanStats &stats, int n) {
+		local = stats;
+		generation = n;
+		active = true;
+#if MPI_VERSION >= 3
+		MPI_Ireduce(&local, &total, OCEAN_STATS_FIELDS, MPI_INT64_T, MPI_SUM, 0, comm, &request);
+#else
+		MPI_Reduce(&local, &total, OCEAN_STATS_FIELDS, MPI_INT64_T, MPI_SUM, 0, comm);
+#endif
+	}
+
+	//true between start and finish
+	bool pending() const { return active; }
+
+	//waits for the sum started by start and returns its generation, sum is only filled on process 0
+	int finish(OceanStats &sum) {
+#if MPI_VERSION >= 3
+		MPI_Wait(&request, MPI_STATUS_IGNORE);
+#endif
+		active = false;
+		sum = total;
+		return generation;
+	}
+
+private:
+	//the reduction in flight points into the object, so it cannot be copied
+	StatsReduction(const StatsReduction &);
+	StatsReduction &operator=(const StatsReduction &);
+
+	MPI_Comm comm;
+	bool active;
+	int generation;
+	//the buffers must not move while the reduction is in flight
+	OceanStats local;
+	OceanStats total;
+	MPI_Request request;
+};
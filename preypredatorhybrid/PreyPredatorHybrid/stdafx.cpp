@@ -1,7 +1,7 @@
-// stdafx.cpp : source file that includes just the standard includes
-// PreyPredatorHybrid.pch will be the pre-compiled header
-// stdafx.obj will contain the pre-compiled type information
-
-#include "stdafx.h"
-
-
+// stdafx.cpp : source file that includes just the standard includes
+// PreyPredatorHybrid.pch will be the pre-compiled header
+// stdafx.obj will contain the pre-compiled type information
+
+#include "stdafx.h"
+
+